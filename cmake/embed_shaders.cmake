@@ -0,0 +1,52 @@
+# Generates a C++ include file holding compiled SPIR-V as constexpr arrays.
+#
+# usage: cmake -DOUTPUT=<file> -DSPIRV_FILES=<a.spv|b.spv|...> -P embed_shaders.cmake
+#
+# The list is separated by '|' so it survives being passed on a command line.
+
+if(NOT OUTPUT OR NOT SPIRV_FILES)
+  message(FATAL_ERROR "embed_shaders.cmake needs OUTPUT and SPIRV_FILES")
+endif()
+
+string(REPLACE "|" ";" SPIRV_FILES "${SPIRV_FILES}")
+
+set(ARRAYS "")
+set(ENTRIES "")
+set(COUNT 0)
+
+foreach(SPIRV ${SPIRV_FILES})
+  get_filename_component(NAME ${SPIRV} NAME)
+  string(MAKE_C_IDENTIFIER "${NAME}" IDENTIFIER)
+
+  file(READ ${SPIRV} HEX HEX)
+  string(LENGTH "${HEX}" HEX_LENGTH)
+  math(EXPR REMAINDER "${HEX_LENGTH} % 8")
+  if(HEX_LENGTH EQUAL 0 OR NOT REMAINDER EQUAL 0)
+    message(FATAL_ERROR "${SPIRV} is not a whole number of SPIR-V words")
+  endif()
+
+  # SPIR-V is little endian, swap each group of four bytes into a word
+  string(REGEX REPLACE "(..)(..)(..)(..)" "0x\\4\\3\\2\\1, " WORDS "${HEX}")
+  # eight words per line, cmake regular expressions have no {n} repetition
+  string(REPEAT "0x[0-9a-f]+, " 8 LINE_PATTERN)
+  string(REGEX REPLACE "(${LINE_PATTERN})" "\\1\n  " WORDS "${WORDS}")
+  string(REPLACE ", \n" ",\n" WORDS "${WORDS}")
+  string(STRIP "${WORDS}" WORDS)
+
+  string(APPEND ARRAYS "constexpr uint32_t ${IDENTIFIER}[] = {\n  ${WORDS}\n};\n\n")
+  string(APPEND ENTRIES "  EmbeddedShader{\"${NAME}\", ${IDENTIFIER}, sizeof(${IDENTIFIER})},\n")
+  math(EXPR COUNT "${COUNT} + 1")
+endforeach()
+
+set(CONTENT "// generated by cmake/embed_shaders.cmake, do not edit\n\n")
+string(APPEND CONTENT "${ARRAYS}")
+string(APPEND CONTENT "constexpr std::array<EmbeddedShader, ${COUNT}> embeddedShaders = {\n${ENTRIES}};\n")
+
+# only touch the output when it changes, so dependents are not rebuilt needlessly
+if(EXISTS ${OUTPUT})
+  file(READ ${OUTPUT} PREVIOUS)
+  if(PREVIOUS STREQUAL CONTENT)
+    return()
+  endif()
+endif()
+file(WRITE ${OUTPUT} "${CONTENT}")
@@ -6,8 +6,17 @@ layout(location = 2) in vec3 vColor;
 
 layout(location = 0) out vec3 outColor;
 
+layout(set = 0, binding = 0) uniform CameraData {
+  mat4 view;
+  mat4 proj;
+  mat4 viewProj;
+} camera;
+
+layout(set = 0, binding = 1) uniform ObjectData {
+  mat4 model;
+} object;
 
 void main() {
-  gl_Position = vec4(vPosition, 1.0f);
+  gl_Position = camera.viewProj * object.model * vec4(vPosition, 1.0f);
   outColor = vColor;
 }
\ No newline at end of file
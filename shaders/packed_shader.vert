@@ -0,0 +1,36 @@
+#version 450
+
+// PackedVertex, positions normalized within the mesh bounds and octahedral normals
+layout(location = 0) in vec4 vPosition;
+layout(location = 1) in vec2 vNormal;
+layout(location = 2) in vec4 vColor;
+
+layout(location = 0) out vec3 outColor;
+layout(location = 1) out vec3 outNormal;
+
+layout(set = 0, binding = 0) uniform CameraData {
+  mat4 view;
+  mat4 proj;
+  mat4 viewProj;
+} camera;
+
+layout(set = 0, binding = 1) uniform ObjectData {
+  mat4 model;
+  vec4 positionOffset;
+  vec4 positionScale;
+} object;
+
+vec3 octahedralDecode(vec2 encoded) {
+  vec3 normal = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+  // unfold the lower hemisphere
+  float t = max(-normal.z, 0.0);
+  normal.xy += vec2(normal.x >= 0.0 ? -t : t, normal.y >= 0.0 ? -t : t);
+  return normalize(normal);
+}
+
+void main() {
+  vec3 position = object.positionOffset.xyz + object.positionScale.xyz * vPosition.xyz;
+  gl_Position = camera.viewProj * object.model * vec4(position, 1.0f);
+  outColor = vColor.rgb;
+  outNormal = mat3(object.model) * octahedralDecode(vNormal);
+}
@@ -1,5 +1,8 @@
 #include "engine.h"
+#include "gltf_loader.h"
+#include "obj_importer.h"
 
+#include "../util/profiler.h"
 #include "../util/types.h"
 #include "../vulkan/vk.h"
 #include "../vulkan/pipeline_builder.h"
@@ -8,14 +11,20 @@
 #include <SDL_keycode.h>
 #include <SDL_video.h>
 
+#include <algorithm>
+#include <cctype>
 #include <chrono>
 #include <cstdint>
+#include <filesystem>
 #include <glm/ext/matrix_transform.hpp>
+#include <iostream>
 #include <memory>
 #include <stdexcept>
+#include <string>
 #include <synchapi.h>
 #include <thread>
 #include <tuple>
+#include <unordered_set>
 #include <utility>
 #include <windows.h>
 
@@ -28,13 +37,29 @@ namespace mb {
 /**
  * @brief primes the engine
  * 
+ * @param _config : startup options for the engine
  */
-void Engine::init() {
-  vk::init();
+void Engine::init(const EngineConfig& _config) {
+  Profiler::setThreadName("main");
+  MB_PROFILE_ZONE("Engine::init");
+
+  config = _config;
+  framesInFlight = std::max(config.framesInFlight, 1u);
+  vk::init(config.width, config.height, framesInFlight, config.headless, config.dynamicRendering, config.extendedDynamicState);
+  threadPool = std::make_unique<ThreadPool>();
+  if (config.recordThreads > 0) {
+    recordThreadPool = std::make_unique<ThreadPool>(config.recordThreads, "recorder");
+  }
+  shaderLibrary = std::make_unique<ShaderLibrary>();
+  if (!config.pipelineCachePath.empty()) {
+    pipelineCache = std::make_unique<PipelineCache>(config.pipelineCachePath);
+  }
   // initialize frames
   initPipelines();
-  initFrames();
+  initSync();
+  // frame uniforms are sized by the number of scene draws
   initMeshes();
+  initFrames();
 }
 
 /**
@@ -42,16 +67,46 @@ void Engine::init() {
  *        drawing graphics
  */
 void Engine::run() {
+  if (config.headless) {
+    runHeadless();
+    return;
+  }
+
   SDL_Event event;
   bool shouldQuit = false;
+  uint64_t framesDrawn = 0;
 
    while (!shouldQuit) {
+    MB_PROFILE_ZONE("frame");
+
     // handle window events
     while (SDL_PollEvent(&event) != 0) {
       switch(event.type) {
         case SDL_QUIT:
           shouldQuit = true;
           break;
+        case SDL_KEYDOWN:
+          // switch frame pacing live
+          switch(event.key.keysym.sym) {
+            case SDLK_1:
+              setFramePacing(FramePacing::LowLatency);
+              break;
+            case SDLK_2:
+              setFramePacing(FramePacing::Balanced);
+              break;
+            case SDLK_3:
+              setFramePacing(FramePacing::Throughput);
+              break;
+            case SDLK_F11:
+              gpuProfiler->dump("gpu_profile.txt");
+              break;
+            case SDLK_F12:
+              Profiler::writeChromeTrace("cpu_trace.json");
+              break;
+            default:
+              break;
+          }
+          break;
         case SDL_WINDOWEVENT:
           switch(event.window.event) {
             case SDL_WINDOWEVENT_MINIMIZED:
@@ -85,6 +140,48 @@ void Engine::run() {
 
     // draw functions
     drawFrame();
+
+    if (config.frameLimit != 0 && ++framesDrawn >= config.frameLimit) {
+      shouldQuit = true;
+    }
+  }
+
+  vkDeviceWaitIdle(vk::device);
+  cleanup();
+}
+
+/**
+ * @brief render a fixed number of frames into the offscreen targets and
+ *        report throughput, paced only by the graphics timeline
+ */
+void Engine::runHeadless() {
+  const uint64_t frameLimit = config.frameLimit != 0 ? config.frameLimit : 1000;
+
+  // time rendering only, not pipeline compilation
+  for (auto& pipeline : pipelines) {
+    pipeline->wait();
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  for (uint64_t frame = 0; frame < frameLimit; frame++) {
+    MB_PROFILE_ZONE("frame");
+    drawFrame();
+  }
+  // wait for the last frames in flight so the timing covers all gpu work
+  graphicsTimeline->wait(graphicsTimeline->lastSignaled());
+  const auto end = std::chrono::steady_clock::now();
+
+  const double totalMs = std::chrono::duration<double, std::milli>(end - start).count();
+  std::cout << "[INFO]: rendered " << frameLimit << " frames in " << totalMs << " ms ("
+            << totalMs / frameLimit << " ms/frame, " << frameLimit * 1000.0 / totalMs << " fps)\n";
+
+  if (!config.gpuProfilePath.empty()) {
+    // the frames in flight are only read back when their slot is reused
+    gpuProfiler->collect();
+    gpuProfiler->dump(config.gpuProfilePath);
+  }
+  if (!config.cpuTracePath.empty()) {
+    Profiler::writeChromeTrace(config.cpuTracePath);
   }
 
   vkDeviceWaitIdle(vk::device);
@@ -96,23 +193,81 @@ void Engine::run() {
  * 
  */
 void Engine::cleanup() {
+  // finish pending uploads before freeing what they write to
+  uploadQueue.reset();
+  sceneDraws.clear();
   meshes.clear();
-  for (int i = 0; i < FRAME_COUNT; i++) {
-    cmdBuffers[i].reset();
-    imageAvailableSemaphores[i].reset();
-    renderFinishedSemaphores[i].reset();
-    inFlightFences[i].reset();
-  }
-  descriptors.reset();
-  for (const auto& [name, pipeline] : pipelines) {
-    vkDestroyPipeline(vk::device, pipeline, nullptr);
-  }
-  for (const auto& [name, layout] : descriptorLayouts) {
+  meshPool.reset();
+  texures.clear();
+  destroyFrames();
+  gpuProfiler.reset();
+  transferTimeline.reset();
+  graphicsTimeline.reset();
+  // waits for pipelines still compiling
+  pipelines.clear();
+  pipelineKeys.clear();
+  for (const VkDescriptorSetLayout layout : descriptorLayouts) {
     vkDestroyDescriptorSetLayout(vk::device, layout, nullptr);
   }
-  for (const auto& [name, layout] : pipelineLayouts) {
+  for (const VkPipelineLayout layout : pipelineLayouts) {
     vkDestroyPipelineLayout(vk::device, layout, nullptr);
   }
+  shaderLibrary.reset();
+  descriptorLayouts.clear();
+  pipelineLayouts.clear();
+  if (pipelineCache) {
+    pipelineCache->save();
+    pipelineCache.reset();
+  }
+  recordThreadPool.reset();
+  threadPool.reset();
+}
+
+/**
+ * @brief checks if the GPU has finished rendering a frame
+ * 
+ * @param frame : frame number as returned by getFrameNumber
+ * @return true if every command of the frame has completed
+ */
+bool Engine::isFrameComplete(const uint64_t frame) {
+  // not submitted yet
+  if (frame >= frameNumber) {
+    return false;
+  }
+  // the device was idled when frames in flight changed, or the slot was
+  // already waited on and reused by a later frame
+  if (frame < pacingStartFrame || frame + framesInFlight < frameNumber) {
+    return true;
+  }
+  return graphicsTimeline->isComplete(frameTimelineValues[(frame - pacingStartFrame) % framesInFlight]);
+}
+
+/**
+ * @brief change the number of frames the CPU may record ahead of the GPU,
+ *        rebuilding every per frame object
+ * 
+ * @param count : frames in flight, 1 for lowest latency, 3 for throughput
+ */
+void Engine::setFramesInFlight(const uint32_t count) {
+  if (count == 0) {
+    throw std::runtime_error("[ERROR]: at least one frame must be in flight");
+  }
+  if (count == framesInFlight) {
+    return;
+  }
+
+  vkDeviceWaitIdle(vk::device);
+
+  destroyFrames();
+  framesInFlight = count;
+  initFrames();
+  gpuProfiler->resize(framesInFlight);
+  if (vk::headless) {
+    vk::offscreen->recreate(vk::offscreen->extent, framesInFlight);
+  }
+
+  currentFrame = 0;
+  pacingStartFrame = frameNumber;
 }
 
 /**
@@ -120,60 +275,158 @@ void Engine::cleanup() {
  * 
  */
 void Engine::initPipelines() {
+  frameLayout = descriptorLayouts.insert(DescriptorLayouts::createFrameLayout(), "frame-layout");
+
   VkPipelineLayoutCreateInfo pipelineLayoutInfo {};
   pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-  pipelineLayoutInfo.setLayoutCount = 0;
+  pipelineLayoutInfo.setLayoutCount = 1;
+  pipelineLayoutInfo.pSetLayouts = &descriptorLayouts[frameLayout];
 
   VkPipelineLayout layout;
   if (vkCreatePipelineLayout(vk::device, &pipelineLayoutInfo, nullptr, &layout) != VK_SUCCESS) {
     throw std::runtime_error("[ERROR]: failed to create pipeline layout");
   }
-  pipelineLayouts["empty-layout"] = layout;
+  basicLayout = pipelineLayouts.insert(layout, "basic-layout");
+
+  // the library keeps the modules alive while pipelines compile from them
+  auto vertShader = shaderLibrary->load("shaders/basic_shader.vert.spv");
+  auto fragShader = shaderLibrary->load("shaders/basic_shader.frag.spv");
+  auto packedShader = shaderLibrary->load("shaders/packed_shader.vert.spv");
+
+  // the pipelines of both vertex formats share everything past the vertex stage
+  auto describe = [&](VkShaderModule vertexShader, 
+    const std::vector<VkVertexInputBindingDescription>& bindingDescriptions,
+    const std::vector<VkVertexInputAttributeDescription>& attributeDescriptions) {
+    PipelineBuilder builder;
+    builder.setPipelineLayout(layout);
+    builder.addShaders(vertexShader, fragShader);
+    builder.setVertexInputState(bindingDescriptions, attributeDescriptions);
+    builder.setInputAssemblyState(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
+    builder.setRasterizationState(VK_POLYGON_MODE_FILL, VK_CULL_MODE_NONE, VK_FRONT_FACE_CLOCKWISE);
+    builder.setMultisamplingNone();
+    builder.disableColorBlending();
+    builder.disableDepthtest();
+    return builder;
+  };
 
-  auto vertShader = PipelineBuilder::createShader("shaders/basic_shader.vert.spv");
-  auto fragShader = PipelineBuilder::createShader("shaders/basic_shader.frag.spv");
+  const PipelineBuilder builder = describe(vertShader, Vertex::getBindingDescriptions(), Vertex::getAttributeDescriptions());
+  basicPipeline = createPipeline(builder, "basic-pipeline");
+  basicState = builder.getRenderState();
 
-  auto bindingDescriptions = Vertex::getBindingDescriptions();
-  auto attributeDescriptions = Vertex::getAttributeDescriptions();
+  const PipelineBuilder packedBuilder = describe(packedShader, PackedVertex::getBindingDescriptions(), PackedVertex::getAttributeDescriptions());
+  packedPipeline = createPipeline(packedBuilder, "packed-pipeline");
+}
 
-  PipelineBuilder builder;
-  builder.setPipelineLayout(layout);
-  builder.addShaders(vertShader,fragShader);
-  builder.setVertexInputState(bindingDescriptions, attributeDescriptions);
-  builder.setInputAssemblyState(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
-  builder.setRasterizationState(VK_POLYGON_MODE_FILL, VK_CULL_MODE_NONE, VK_FRONT_FACE_CLOCKWISE);
-  builder.setMultisamplingNone();
-  builder.disableColorBlending();
-  builder.disableDepthtest();
-  auto pipeline = builder.build(vk::swapchain->renderPass);
-  pipelines["basic-pipeline"] = pipeline;
+/**
+ * @brief create the queue timelines, gpu profiler and the upload queue,
+ *        these outlive changes to the number of frames in flight
+ */
+void Engine::initSync() {
+  graphicsTimeline = std::make_unique<TimelineSemaphore>();
+  gpuProfiler = std::make_unique<GpuProfiler>(framesInFlight);
 
-  vkDestroyShaderModule(vk::device, vertShader, nullptr);
-  vkDestroyShaderModule(vk::device, fragShader, nullptr);
+  // uploads run on the dedicated transfer queue when the device has one
+  if (vk::hasDedicatedTransfer()) {
+    transferTimeline = std::make_unique<TimelineSemaphore>();
+  }
+  uploadQueue = std::make_unique<UploadQueue>(
+    vk::transferQueue, 
+    vk::queueIndices.transferFamily.value(), 
+    vk::hasDedicatedTransfer() ? *transferTimeline : *graphicsTimeline,
+    vk::queueIndices.graphicsFamily.value()
+  );
+  meshPool = std::make_unique<MeshPool>(*uploadQueue);
 }
 
 /**
- * @brief initialize command buffers and sync structures for frames
+ * @brief initialize command buffers, sync structures and uniforms for frames
  * 
  */
 void Engine::initFrames() {
-  for (int i = 0; i < FRAME_COUNT; i++) {
-    cmdBuffers.push_back(std::make_unique<Command>());
+  // room for the uniforms of every draw at the largest alignment the spec allows
+  const VkDeviceSize drawCount = static_cast<VkDeviceSize>(std::max(config.objectCount, 1u)) * sceneDraws.size();
+  const VkDeviceSize frameAllocatorSize = FRAME_ALLOCATOR_SIZE + drawCount * 256;
+  for (uint32_t i = 0; i < framesInFlight; i++) {
+    commandAllocators.push_back(std::make_unique<CommandAllocator>());
     imageAvailableSemaphores.push_back(std::make_unique<Semaphore>());
     renderFinishedSemaphores.push_back(std::make_unique<Semaphore>());
-    inFlightFences.push_back(std::make_unique<Fence>());
+    frameAllocators.push_back(std::make_unique<FrameAllocator>(frameAllocatorSize));
+  }
+  frameTimelineValues.assign(framesInFlight, 0);
+
+  // one descriptor set per frame over its allocator, written once and
+  // pointed at each uniform with dynamic offsets when bound
+  descriptors = std::make_unique<Descriptors>(framesInFlight);
+  descriptorSets = descriptors->createDescriptorSets(framesInFlight, descriptorLayouts[frameLayout]);
+  for (uint32_t i = 0; i < framesInFlight; i++) {
+    descriptors->writeDynamicUniformBuffer(descriptorSets[i], 0, frameAllocators[i]->getBuffer(), sizeof(UniformBufferObject));
+    descriptors->writeDynamicUniformBuffer(descriptorSets[i], 1, frameAllocators[i]->getBuffer(), sizeof(ObjectUniforms));
   }
 
-  // immediate submit
-  uploadContext.uploadFence = std::make_unique<Fence>();
-  uploadContext.cmd = std::make_unique<Command>();
+  if (recordThreadPool) {
+    recorder = std::make_unique<ParallelRecorder>(*recordThreadPool, framesInFlight, MIN_DRAWS_PER_THREAD);
+  }
 }
 
 /**
- * @brief init meshes
+ * @brief free all per frame objects, the frames must not be in use by the GPU
+ * 
+ */
+void Engine::destroyFrames() {
+  recorder.reset();
+  commandAllocators.clear();
+  imageAvailableSemaphores.clear();
+  renderFinishedSemaphores.clear();
+  frameAllocators.clear();
+  descriptorSets.clear();
+  frameTimelineValues.clear();
+  descriptors.reset();
+}
+
+/**
+ * @brief describe a pipeline for the active render target, against its
+ *        formats when rendering dynamically and its render pass otherwise
+ * 
+ */
+PipelineDescription Engine::describePipeline(const PipelineBuilder& builder) {
+  if (vk::dynamicRendering) {
+    return builder.describe({vk::getRenderFormat()});
+  }
+  return builder.describe(vk::getRenderPass());
+}
+
+/**
+ * @brief compile a pipeline on the thread pool, or share the pipeline of an
+ *        earlier builder whose settings differ only in dynamic state
+ * 
+ * @param builder : settings of the pipeline, record its getRenderState when drawing
+ * @param name : name the pipeline can be found by, if it is compiled
+ * @return PipelineHandle : handle to the new or shared pipeline
+ */
+PipelineHandle Engine::createPipeline(const PipelineBuilder& builder, const std::string& name) {
+  PipelineDescription description = describePipeline(builder);
+  const uint64_t key = description.hash();
+
+  auto it = pipelineKeys.find(key);
+  if (it != pipelineKeys.end() && pipelines.contains(it->second)) {
+    return it->second;
+  }
+
+  // compiled on the thread pool, frames skip draws until it is ready
+  const PipelineHandle handle = pipelines.insert(
+    std::make_unique<AsyncPipeline>(*threadPool, std::move(description), pipelineCache ? pipelineCache->get() : VK_NULL_HANDLE), 
+    name
+  );
+  pipelineKeys[key] = handle;
+  return handle;
+}
+
+/**
+ * @brief create the built in meshes and import the meshes of the scene
  * 
  */
 void Engine::initMeshes() {
+  MB_PROFILE_ZONE("Engine::initMeshes");
 
   std::vector<Vertex> vertices = {
     {{ 1.f, 1.f, 0.0f }, {}, { 1.f, 0.0f, 0.0f }},
@@ -181,8 +434,73 @@ void Engine::initMeshes() {
     {{ 0.f,-1.f, 0.0f }, {}, { 0.f, 0.0f, 1.0f }},
   };
 
-  meshes["triangle"] = std::make_shared<Mesh>(vertices);
-  uploadMesh(meshes["triangle"]);
+  triangleMesh = meshes.insert(std::make_shared<Mesh>(vertices), "triangle");
+  uploadMesh(meshes[triangleMesh]);
+
+  std::unordered_set<std::string> loadedPaths;
+  for (const auto& path : config.meshPaths) {
+    // the meshes of a file are named after it, so each file is loaded once
+    if (!loadedPaths.insert(std::filesystem::path(path).lexically_normal().string()).second) {
+      std::cerr << "[WARNING]: " << path << " is already loaded\n";
+      continue;
+    }
+    std::string extension = std::filesystem::path(path).extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](const unsigned char c) {return std::tolower(c);});
+    if (extension == ".gltf" || extension == ".glb") {
+      loadGltf(path);
+    }
+    else {
+      loadObj(path);
+    }
+  }
+  if (sceneDraws.empty()) {
+    sceneDraws.push_back({triangleMesh});
+  }
+}
+
+/**
+ * @brief import the meshes of an OBJ file into the scene, at the origin
+ * 
+ * @param filePath : OBJ file
+ */
+void Engine::loadObj(const std::string& filePath) {
+  ObjImporter importer(*threadPool);
+  for (auto& [name, mesh] : importer.load(filePath)) {
+    if (config.packedVertices) {
+      mesh->pack();
+    }
+    const MeshHandle handle = meshes.insert(std::move(mesh), filePath + "/" + name);
+    uploadMesh(meshes[handle]);
+    sceneDraws.push_back({handle});
+  }
+}
+
+/**
+ * @brief load the meshes and textures of a glTF file, drawing every mesh
+ *        where its nodes place it
+ * 
+ * @param filePath : .gltf or .glb file
+ */
+void Engine::loadGltf(const std::string& filePath) {
+  GltfLoader loader(*uploadQueue, *meshPool, config.packedVertices ? VertexFormat::Packed : VertexFormat::Full);
+  GltfScene scene = loader.load(filePath);
+
+  for (size_t i = 0; i < scene.textures.size(); i++) {
+    if (scene.textures[i]) {
+      texures.insert(std::move(scene.textures[i]), filePath + "/image" + std::to_string(i));
+    }
+  }
+
+  // the loader has queued the uploads, only the handles are left to create
+  std::vector<MeshHandle> handles;
+  for (auto& sceneMesh : scene.meshes) {
+    handles.push_back(meshes.insert(std::move(sceneMesh.mesh), filePath + "/" + sceneMesh.name));
+  }
+  for (const auto& node : scene.nodes) {
+    for (const uint32_t mesh : node.meshes) {
+      sceneDraws.push_back({handles[mesh], node.worldTransform});
+    }
+  }
 }
 
 /**
@@ -190,32 +508,52 @@ void Engine::initMeshes() {
  * 
  */
 void Engine::drawFrame() {
-  // wait for gpu to render last frame
-  vkWaitForFences(vk::device, 1, &inFlightFences[currentFrame]->get(), true, 1000000000);
+  MB_PROFILE_ZONE("Engine::drawFrame");
 
-  uint32_t imageIndex;
-  VkResult result = vkAcquireNextImageKHR(vk::device, vk::swapchain->get(), UINT64_MAX, imageAvailableSemaphores[currentFrame]->get(), VK_NULL_HANDLE, &imageIndex);
-  // check for out of date swapchain
-  if (result == VK_ERROR_OUT_OF_DATE_KHR) {
-    framebufferResized = true;
-    return;
+  // wait for gpu to finish the last frame that used this slot
+  {
+    MB_PROFILE_ZONE("wait-for-frame");
+    graphicsTimeline->wait(frameTimelineValues[currentFrame]);
   }
-  else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
-    throw std::runtime_error("[ERROR]: failed to acquire swapchain image");
+  meshPool->reclaim(graphicsTimeline->completed());
+
+  // headless frames own one offscreen image each, so there is nothing to acquire
+  uint32_t imageIndex = currentFrame;
+  VkResult result = VK_SUCCESS;
+  if (!vk::headless) {
+    MB_PROFILE_ZONE("acquire-image");
+    result = vkAcquireNextImageKHR(vk::device, vk::swapchain->get(), UINT64_MAX, imageAvailableSemaphores[currentFrame]->get(), VK_NULL_HANDLE, &imageIndex);
+    // check for out of date swapchain
+    if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+      framebufferResized = true;
+      return;
+    }
+    else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+      throw std::runtime_error("[ERROR]: failed to acquire swapchain image");
+    }
   }
- 
-  vkResetFences(vk::device, 1, &inFlightFences[currentFrame]->get());
 
-  // reset command buffer to begin recording again
-  vkResetCommandBuffer(cmdBuffers[currentFrame]->buffer, 0);
+  // submit the uploads requested since the last frame, overlapping with rendering
+  // when they run on the transfer queue
+  uploadQueue->flush();
+
+  // the frame has completed, so every command buffer it used is reset at once
+  commandAllocators[currentFrame]->reset();
+  const VkCommandBuffer buffer = commandAllocators[currentFrame]->allocate();
 
-  // update descriptor sets
-  //updateUniformBuffer(currentFrame);
+  // the frame has completed, so its uniform memory can be rewritten
+  frameAllocators[currentFrame]->reset();
+  updateUniformBuffer(currentFrame);
+  // meshes move before their draws are resolved, the copies are recorded with the frame
+  meshPool->defragment();
+  updateScene();
 
-  recordCommandBuffer(cmdBuffers[currentFrame]->buffer, imageIndex);
+  recordCommandBuffer(buffer, imageIndex);
+  frameAllocators[currentFrame]->flush();
 
   
-  result = submitFrame(currentFrame, imageIndex);
+  result = submitFrame(buffer, currentFrame, imageIndex);
+  meshPool->release(frameTimelineValues[currentFrame]);
 
   if (result == VK_ERROR_OUT_OF_DATE_KHR) {
     framebufferResized = true;
@@ -223,7 +561,170 @@ void Engine::drawFrame() {
       throw std::runtime_error("[ERROR]: failed to present swapchain image");
   }
 
-  currentFrame = (currentFrame + 1) % FRAME_COUNT;
+  frameNumber++;
+  currentFrame = (currentFrame + 1) % framesInFlight;
+}
+
+/**
+ * @brief start rendering to an image of the active render target, cleared
+ *        to black
+ * 
+ * @param buffer : command buffer being recorded
+ * @param imageIndex : image of the render target to draw to
+ * @param secondary : draws are recorded into secondary command buffers
+ */
+void Engine::beginRendering(const VkCommandBuffer buffer, const uint32_t imageIndex, const bool secondary) {
+  VkClearValue clearColor = {{{0.0f, 0.0f, 0.0f, 1.0f}}};
+
+  if (!vk::dynamicRendering) {
+    VkRenderPassBeginInfo renderPassInfo {};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderPassInfo.renderPass = vk::getRenderPass();
+    renderPassInfo.framebuffer = vk::getFramebuffer(imageIndex);
+    renderPassInfo.renderArea.offset = {0,0};
+    renderPassInfo.renderArea.extent = vk::getRenderExtent();
+    renderPassInfo.clearValueCount = 1;
+    renderPassInfo.pClearValues = &clearColor;
+
+    vkCmdBeginRenderPass(buffer, &renderPassInfo, secondary ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE);
+    return;
+  }
+
+  // the layout transition the render pass did as its initial layout
+  VkImageMemoryBarrier barrier {};
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.srcAccessMask = 0;
+  barrier.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+  barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  barrier.newLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image = vk::getRenderImage(imageIndex);
+  barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+  vkCmdPipelineBarrier(buffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+  VkRenderingAttachmentInfo colorAttachment {};
+  colorAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+  colorAttachment.imageView = vk::getRenderImageView(imageIndex);
+  colorAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+  colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+  colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+  colorAttachment.clearValue = clearColor;
+
+  VkRenderingInfo renderingInfo {};
+  renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+  renderingInfo.flags = secondary ? VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT : 0;
+  renderingInfo.renderArea.offset = {0, 0};
+  renderingInfo.renderArea.extent = vk::getRenderExtent();
+  renderingInfo.layerCount = 1;
+  renderingInfo.colorAttachmentCount = 1;
+  renderingInfo.pColorAttachments = &colorAttachment;
+
+  vk::cmdBeginRendering(buffer, &renderingInfo);
+}
+
+/**
+ * @brief finish rendering to an image and leave it ready to present or
+ *        read back
+ * 
+ * @param buffer : command buffer being recorded
+ * @param imageIndex : image of the render target that was drawn to
+ */
+void Engine::endRendering(const VkCommandBuffer buffer, const uint32_t imageIndex) {
+  if (!vk::dynamicRendering) {
+    vkCmdEndRenderPass(buffer);
+    return;
+  }
+
+  vk::cmdEndRendering(buffer);
+
+  // the transition the render pass did as its final layout
+  const bool present = vk::getRenderFinalLayout() == VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+  VkImageMemoryBarrier barrier {};
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+  barrier.dstAccessMask = present ? 0 : VK_ACCESS_TRANSFER_READ_BIT;
+  barrier.oldLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+  barrier.newLayout = vk::getRenderFinalLayout();
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image = vk::getRenderImage(imageIndex);
+  barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+  vkCmdPipelineBarrier(
+    buffer, 
+    VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 
+    present ? VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT : VK_PIPELINE_STAGE_TRANSFER_BIT, 
+    0, 0, nullptr, 0, nullptr, 1, &barrier
+  );
+}
+
+/**
+ * @brief write the camera matrices of a frame
+ * 
+ * @param currentFrame : frame in flight whose allocator is written
+ */
+void Engine::updateUniformBuffer(const uint32_t currentFrame) {
+  const VkExtent2D extent = vk::getRenderExtent();
+
+  UniformBufferObject ubo {};
+  ubo.view = glm::lookAt(cameraPosition, glm::vec3(0.f), glm::vec3(0.f, 1.f, 0.f));
+  ubo.proj = glm::perspective(glm::radians(70.f), extent.width / static_cast<float>(extent.height), 0.1f, CAMERA_FAR);
+  // glm targets OpenGL clip space, where y points up
+  ubo.proj[1][1] *= -1;
+  ubo.viewProj = ubo.proj * ubo.view;
+
+  cameraOffset = frameAllocators[currentFrame]->push(ubo);
+}
+
+/**
+ * @brief push the draws of the frame to the render queue and sort them,
+ *        writing their object uniforms
+ * 
+ */
+void Engine::updateScene() {
+  renderQueue.clear();
+
+  FrameAllocator& frameAllocator = *frameAllocators[currentFrame];
+  const uint32_t objectCount = std::max(config.objectCount, 1u);
+  for (uint32_t i = 0; i < objectCount; i++) {
+    // copies are spread evenly around the spin
+    const float angle = frameNumber * 0.4f + i * 360.f / objectCount;
+    const glm::mat4 spin = glm::rotate(glm::mat4(1.f), glm::radians(angle), glm::vec3(0.f, 1.f, 0.f));
+
+    for (const SceneDraw& draw : sceneDraws) {
+      const Mesh& mesh = *meshes[draw.mesh];
+      const PipelineHandle pipeline = mesh.getVertexFormat() == VertexFormat::Packed ? packedPipeline : basicPipeline;
+      // skip the draw while its pipeline is still compiling
+      if (!pipelines[pipeline]->isReady()) continue;
+
+      ObjectUniforms object {};
+      object.model = spin * draw.transform;
+      object.positionOffset = glm::vec4(mesh.getQuantization().offset, 0.f);
+      object.positionScale = glm::vec4(mesh.getQuantization().scale, 0.f);
+
+      DrawPacket packet {};
+      packet.pipeline = pipelines[pipeline]->get();
+      packet.state = &basicState;
+      packet.layout = pipelineLayouts[basicLayout];
+      packet.descriptorSet = descriptorSets[currentFrame];
+      packet.dynamicOffsets[0] = cameraOffset;
+      packet.dynamicOffsets[1] = frameAllocator.push(object);
+      // meshes share the buffers of their pool block, only the offsets differ
+      const MeshRange range = meshPool->getRange(mesh.getAllocation());
+      packet.vertexBuffer = range.vertexBuffer;
+      packet.indexBuffer = range.indexBuffer;
+      packet.indexType = mesh.getIndexType();
+      packet.count = mesh.indexCount();
+      packet.firstIndex = range.firstIndex;
+      packet.vertexOffset = range.vertexOffset;
+
+      // opaque draws go front to back
+      const float depth = glm::distance(cameraPosition, glm::vec3(object.model[3])) / CAMERA_FAR;
+      renderQueue.push(RenderQueue::makeKey(OPAQUE_PASS, pipeline.index, 0, draw.mesh.index, depth), packet);
+    }
+  }
+
+  renderQueue.sort();
 }
 
 /**
@@ -233,147 +734,182 @@ void Engine::drawFrame() {
  * @param imageIndex : image of the swapchain image to write to
  */
 void Engine::recordCommandBuffer(const VkCommandBuffer buffer, const uint32_t imageIndex) {
+  MB_PROFILE_ZONE("Engine::recordCommandBuffer");
+
   VkCommandBufferBeginInfo beginInfo {};
   beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-  beginInfo.flags = 0;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
   beginInfo.pInheritanceInfo = nullptr;
   
   if (vkBeginCommandBuffer(buffer, &beginInfo) != VK_SUCCESS) {
     throw std::runtime_error("[ERROR]: failed to begin recording command buffer");
   }
 
-  VkRenderPassBeginInfo renderPassInfo {};
-  renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-  renderPassInfo.renderPass = vk::swapchain->renderPass;
-  renderPassInfo.framebuffer = vk::swapchain->framebuffers[imageIndex];
-  renderPassInfo.renderArea.offset = {0,0};
-  renderPassInfo.renderArea.extent = vk::swapchain->swapchainExtent;
+  // the slot was waited on in drawFrame, so its previous timestamps are ready
+  gpuProfiler->beginFrame(buffer, currentFrame);
+  const uint32_t frameScope = gpuProfiler->beginScope(buffer, "frame");
+
+  // take ownership of resources uploaded on the transfer queue
+  uploadWaitValue = uploadQueue->recordAcquireBarriers(buffer);
+  // copies of compacted mesh blocks, after the acquires of the data they copy
+  meshPool->recordMoves(buffer);
+  const uint32_t passScope = gpuProfiler->beginScope(buffer, "main-pass");
+
+  const uint32_t drawCount = renderQueue.size();
+  // large draw lists are split across the recording threads
+  const bool parallel = recorder && drawCount > MIN_DRAWS_PER_THREAD;
+
+  beginRendering(buffer, imageIndex, parallel);
+
+  if (parallel) {
+    // the slices continue the render pass or dynamic rendering begun above
+    const VkFormat colorFormat = vk::getRenderFormat();
+    VkCommandBufferInheritanceRenderingInfo renderingInheritance {};
+    renderingInheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO;
+    renderingInheritance.colorAttachmentCount = 1;
+    renderingInheritance.pColorAttachmentFormats = &colorFormat;
+    renderingInheritance.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+    VkCommandBufferInheritanceInfo inheritance {};
+    inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    if (vk::dynamicRendering) {
+      inheritance.pNext = &renderingInheritance;
+    }
+    else {
+      inheritance.renderPass = vk::getRenderPass();
+      inheritance.subpass = 0;
+      inheritance.framebuffer = vk::getFramebuffer(imageIndex);
+    }
 
-  VkClearValue clearColor = {{{0.0f, 0.0f, 0.0f, 1.0f}}};
-  renderPassInfo.clearValueCount = 1;
-  renderPassInfo.pClearValues = &clearColor;
+    recorder->record(buffer, currentFrame, inheritance, drawCount, [this](VkCommandBuffer slice, const uint32_t first, const uint32_t count) {
+      recordDraws(slice, first, count);
+    });
+  }
+  else if (drawCount > 0) {
+    GpuScope drawScope(*gpuProfiler, buffer, "draws");
+    recordDraws(buffer, 0, drawCount);
+  }
 
-  vkCmdBeginRenderPass(buffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+  endRendering(buffer, imageIndex);
 
-  vkCmdBindPipeline(buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines["basic-pipeline"]);
+  gpuProfiler->endScope(buffer, passScope);
+  gpuProfiler->endScope(buffer, frameScope);
 
+  if (vkEndCommandBuffer(buffer) != VK_SUCCESS) {
+    throw std::runtime_error("[ERROR]: failed to record command buffer");
+  }
+}
+
+/**
+ * @brief record a range of the sorted render queue, called from the
+ *        recording threads so it only reads shared state
+ * 
+ * @param buffer : primary buffer inside the pass, or a secondary buffer continuing it
+ * @param first : first draw to record
+ * @param count : number of draws to record
+ */
+void Engine::recordDraws(const VkCommandBuffer buffer, const uint32_t first, const uint32_t count) {
+  // dynamic state is not inherited by secondary buffers
   VkViewport viewport {};
   viewport.x = 0.0f;
   viewport.y = 0.0f;
-  viewport.width = static_cast<float>(vk::swapchain->swapchainExtent.width);
-  viewport.height = static_cast<float>(vk::swapchain->swapchainExtent.height);
+  viewport.width = static_cast<float>(vk::getRenderExtent().width);
+  viewport.height = static_cast<float>(vk::getRenderExtent().height);
   viewport.minDepth = 0.0f;
   viewport.maxDepth = 1.0f;
   vkCmdSetViewport(buffer, 0, 1, &viewport);
 
   VkRect2D scissor{};
   scissor.offset = {0, 0};
-  scissor.extent = vk::swapchain->swapchainExtent;
+  scissor.extent = vk::getRenderExtent();
   vkCmdSetScissor(buffer, 0, 1, &scissor);
 
-  vkCmdBindPipeline(buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines["basic-pipeline"]);
-
-  VkDeviceSize offset = 0;
-  vkCmdBindVertexBuffers(buffer, 0, 1, &meshes["triangle"]->vertexBuffer.buffer, &offset);
-
-  vkCmdDraw(buffer, meshes["triangle"]->vertexCount(), 1, 0, 0);
+  renderQueue.record(buffer, first, count);
+}
 
-  // vkCmdDraw(buffer, 3, 1, 0, 0);
+/**
+ * @brief submit the recorded frame and present it to the swapchain
+ * 
+ * @param buffer : command buffer recorded for the frame
+ * @param currentFrame : index of the frame in flight
+ * @param imageIndex : image of the swapchain to present
+ * @return VkResult : result of presentation, always VK_SUCCESS when headless
+ */
+VkResult Engine::submitFrame(const VkCommandBuffer buffer, const uint32_t currentFrame, const uint32_t imageIndex) {
+  MB_PROFILE_ZONE("Engine::submitFrame");
 
-  vkCmdEndRenderPass(buffer);
+  VkSubmitInfo submitInfo {};
+  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-  if (vkEndCommandBuffer(buffer) != VK_SUCCESS) {
-    throw std::runtime_error("[ERROR]: failed to record command buffer");
+  frameTimelineValues[currentFrame] = graphicsTimeline->next();
+
+  // the timeline is always signaled, the binary semaphores are only needed to present
+  VkSemaphore waitSemaphores[2];
+  VkPipelineStageFlags waitStages[2];
+  uint64_t waitValues[2];
+  uint32_t waitCount = 0;
+  if (!vk::headless) {
+    waitSemaphores[waitCount] = imageAvailableSemaphores[currentFrame]->get();
+    waitStages[waitCount] = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    waitValues[waitCount++] = 0;
+  }
+  // uploads released by the transfer queue must finish before they are acquired
+  if (uploadWaitValue != 0) {
+    waitSemaphores[waitCount] = uploadQueue->getTimeline().get();
+    waitStages[waitCount] = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+    waitValues[waitCount++] = uploadWaitValue;
+    uploadWaitValue = 0;
   }
-}
 
-VkResult Engine::submitFrame(const uint32_t currentFrame, const uint32_t imageIndex) {
-  VkSubmitInfo submitInfo {};
-  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  VkSemaphore signalSemaphores[] = {graphicsTimeline->get(), renderFinishedSemaphores[currentFrame]->get()};
+  uint64_t signalValues[] = {frameTimelineValues[currentFrame], 0};
+  const uint32_t signalCount = vk::headless ? 1 : 2;
+
+  VkTimelineSemaphoreSubmitInfo timelineInfo {};
+  timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+  timelineInfo.waitSemaphoreValueCount = waitCount;
+  timelineInfo.pWaitSemaphoreValues = waitValues;
+  timelineInfo.signalSemaphoreValueCount = signalCount;
+  timelineInfo.pSignalSemaphoreValues = signalValues;
+  submitInfo.pNext = &timelineInfo;
 
-  VkSemaphore waitSemaphores[] = {imageAvailableSemaphores[currentFrame]->get()};
-  VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-  submitInfo.waitSemaphoreCount = 1;
+  submitInfo.waitSemaphoreCount = waitCount;
   submitInfo.pWaitSemaphores = waitSemaphores;
   submitInfo.pWaitDstStageMask = waitStages;
-
   submitInfo.commandBufferCount = 1;
-  submitInfo.pCommandBuffers = &cmdBuffers[currentFrame]->buffer;
-
-  VkSemaphore signalSemaphores[] = {renderFinishedSemaphores[currentFrame]->get()};
-  submitInfo.signalSemaphoreCount = 1;
+  submitInfo.pCommandBuffers = &buffer;
+  submitInfo.signalSemaphoreCount = signalCount;
   submitInfo.pSignalSemaphores = signalSemaphores;
 
-  if (vkQueueSubmit(vk::graphicsQueue, 1, &submitInfo, inFlightFences[currentFrame]->get()) != VK_SUCCESS) {
+  if (vkQueueSubmit(vk::graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
     throw std::runtime_error("[ERROR]: Failed to submit draw command buffer!");
   }
 
+  if (vk::headless) {
+    return VK_SUCCESS;
+  }
+
   VkPresentInfoKHR presentInfo {};
   presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 
   presentInfo.waitSemaphoreCount = 1;
-  presentInfo.pWaitSemaphores = signalSemaphores;
+  presentInfo.pWaitSemaphores = &signalSemaphores[1];
 
   VkSwapchainKHR swapchains[] = {vk::swapchain->get()};
   presentInfo.swapchainCount = 1;
   presentInfo.pSwapchains = swapchains;
   presentInfo.pImageIndices = &imageIndex;
 
+  MB_PROFILE_ZONE("present");
   return vkQueuePresentKHR(vk::presentQueue, &presentInfo);
 }
 
-void Engine::immediateSubmit(std::function<void(VkCommandBuffer)>&& function) {
-  VkCommandBuffer cmd = uploadContext.cmd->buffer;
-
-  VkCommandBufferBeginInfo cmdInfo {};
-	cmdInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-	cmdInfo.pNext = nullptr;
-	cmdInfo.pInheritanceInfo = nullptr;
-	cmdInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-
-  if (vkBeginCommandBuffer(cmd, &cmdInfo) != VK_SUCCESS) {
-    throw std::runtime_error("{ERROR]: failed to begin command buffer");
-  }
-
-  function(cmd);
-
-  if (vkEndCommandBuffer(cmd) != VK_SUCCESS) {
-    throw std::runtime_error("{ERROR]: failed to end command buffer");
-  }
-
-  VkSubmitInfo submitInfo {};
-  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submitInfo.pNext = nullptr;
-
-	submitInfo.waitSemaphoreCount = 0;
-	submitInfo.pWaitSemaphores = nullptr;
-	submitInfo.pWaitDstStageMask = nullptr;
-	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &cmd;
-	submitInfo.signalSemaphoreCount = 0;
-	submitInfo.pSignalSemaphores = nullptr;
-
-  if (vkQueueSubmit(vk::graphicsQueue, 1, &submitInfo, uploadContext.uploadFence->get()) != VK_SUCCESS) {
-    throw std::runtime_error("{ERROR]: submit command buffer");
-  }
-
-  vkWaitForFences(vk::device, 1, &uploadContext.uploadFence->get(), true, 9999999999);
-	vkResetFences(vk::device, 1, &uploadContext.uploadFence->get());
-
-  vkResetCommandPool(vk::device, uploadContext.cmd->pool, 0);
-}
-
 void Engine::uploadMesh(std::shared_ptr<Mesh> mesh) {
-  
-  mesh->vertexBuffer.allocateBuffer(
-    VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, 
-    VMA_MEMORY_USAGE_CPU_TO_GPU, 
-    0, 
-    mesh->size()
-  );
-
-  mesh->copyToAllocation();
+  mesh->allocateBuffers(*meshPool);
 
+  meshPool->uploadVertices(mesh->getAllocation(), mesh->vertexData());
+  // batches complete in order, so the later ticket covers both ranges
+  mesh->uploadTicket = meshPool->uploadIndices(mesh->getAllocation(), mesh->indices());
 }
 
 }
\ No newline at end of file
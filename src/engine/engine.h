@@ -1,32 +1,86 @@
 #pragma once
 
-#include "../vulkan/command.h"
-#include "../vulkan/fence.h"
+#include "../vulkan/command_allocator.h"
 #include "../vulkan/semaphore.h"
+#include "../vulkan/timeline_semaphore.h"
+#include "../vulkan/upload_queue.h"
 #include "../vulkan/descriptors.h"
+#include "../vulkan/frame_allocator.h"
+#include "../vulkan/gpu_profiler.h"
+#include "../vulkan/pipeline_cache.h"
+#include "../vulkan/async_pipeline.h"
+#include "../vulkan/shader_library.h"
+#include "../vulkan/parallel_recorder.h"
+#include "../util/handle_pool.h"
+#include "../util/thread_pool.h"
 
 #include "mesh.h"
+#include "mesh_pool.h"
+#include "render_queue.h"
 #include "texture.h"
 
 #include <SDL_stdinc.h>
-#include <functional>
 #include <glm/glm.hpp>
 #include <vulkan/vulkan_core.h>
 
 #include <cstdint>
 #include <memory>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
 namespace mb {
 
-constexpr unsigned int FRAME_COUNT = 2;
+/**
+ * @brief presets for how many frames the CPU may record ahead of the GPU
+ * 
+ */
+enum class FramePacing : uint32_t {
+  LowLatency = 1, // lowest input latency for interactive stations
+  Balanced = 2,
+  Throughput = 3, // keeps the GPU saturated on render nodes
+};
 
-struct UploadContext {
-  std::unique_ptr<Fence> uploadFence;
-  std::unique_ptr<Command> cmd;
+/**
+ * @brief startup options for the engine
+ * 
+ */
+struct EngineConfig {
+  uint32_t width = 900;
+  uint32_t height = 600;
+  // render into offscreen images with no window, surface or present queue
+  bool headless = false;
+  // number of frames to render before exiting, 0 runs until quit
+  uint64_t frameLimit = 0;
+  // number of frames in flight, see FramePacing
+  uint32_t framesInFlight = static_cast<uint32_t>(FramePacing::Balanced);
+  // files the gpu timings and cpu trace are written to on exit from a headless run
+  std::string gpuProfilePath;
+  std::string cpuTracePath;
+  // pipeline cache loaded at startup and saved on exit, empty to disable
+  std::string pipelineCachePath = "pipeline_cache.bin";
+  // render without render passes and framebuffers when the device supports it
+  bool dynamicRendering = true;
+  // set cull, depth and blend state while recording when the device supports it,
+  // so pipelines differing only in that state share one compiled pipeline
+  bool extendedDynamicState = true;
+  // threads recording slices of large draw lists next to the main thread, 0 records on the main thread only
+  uint32_t recordThreads = ThreadPool::defaultThreadCount();
+  // copies of the scene object drawn each frame, to load the recorder
+  uint32_t objectCount = 1;
+  // OBJ, glTF and GLB files drawn instead of the triangle, OBJ files are imported
+  // through a cache next to each file
+  std::vector<std::string> meshPaths;
+  // store the loaded meshes as PackedVertex instead of Vertex
+  bool packedVertices = false;
 };
 
+using DescriptorLayoutHandle = Handle<VkDescriptorSetLayout>;
+using PipelineLayoutHandle = Handle<VkPipelineLayout>;
+using PipelineHandle = Handle<std::unique_ptr<AsyncPipeline>>;
+using MeshHandle = Handle<std::shared_ptr<Mesh>>;
+using TextureHandle = Handle<std::unique_ptr<Texture>>;
+
 /**
  * @brief Main engine for controlling all processes
  * 
@@ -38,42 +92,120 @@ public:
   Engine (const Engine&) = delete;
   Engine& operator= (const Engine&) = delete;
 
-  void init();
+  void init(const EngineConfig& _config = {});
   void run();
   void cleanup();
 
+  uint64_t getFrameNumber() const {return frameNumber;}
+  bool isFrameComplete(const uint64_t frame);
+
+  uint32_t getFramesInFlight() const {return framesInFlight;}
+  void setFramesInFlight(const uint32_t count);
+  void setFramePacing(const FramePacing pacing) {setFramesInFlight(static_cast<uint32_t>(pacing));}
+
+  GpuProfiler& getGpuProfiler() {return *gpuProfiler;}
+  UploadQueue& getUploadQueue() {return *uploadQueue;}
+  // command buffers for the frame being recorded, only to be used while drawFrame
+  // records it, the buffers stay valid until the frame's slot is reused
+  CommandAllocator& getCommandAllocator() {return *commandAllocators[currentFrame];}
+
 private:
+  // size of the uniform memory of each frame in flight
+  static constexpr VkDeviceSize FRAME_ALLOCATOR_SIZE = 1024 * 1024;
+  // fewest draws a recording thread is given, smaller lists record inline
+  static constexpr uint32_t MIN_DRAWS_PER_THREAD = 128;
+  // far plane of the camera, draws are sorted by their depth within it
+  static constexpr float CAMERA_FAR = 100.f;
+  // passes of the render queue, recorded in this order
+  static constexpr uint32_t OPAQUE_PASS = 0;
+
+  EngineConfig config;
+
   std::unique_ptr<Descriptors> descriptors;
-  std::unordered_map<std::string, VkDescriptorSetLayout> descriptorLayouts;
-  std::unordered_map<std::string, VkPipelineLayout> pipelineLayouts;
-  std::unordered_map<std::string, VkPipeline> pipelines;
-  std::unordered_map<std::string, std::shared_ptr<Mesh>> meshes;
-  std::unordered_map<std::string, std::unique_ptr<Texture>>  texures;
+  // compiles pipelines and other startup work off the main thread
+  std::unique_ptr<ThreadPool> threadPool;
+  // records draw slices each frame, apart from threadPool so startup work never delays a frame
+  std::unique_ptr<ThreadPool> recordThreadPool;
+  std::unique_ptr<PipelineCache> pipelineCache;
+  std::unique_ptr<ShaderLibrary> shaderLibrary;
+  HandlePool<VkDescriptorSetLayout> descriptorLayouts;
+  HandlePool<VkPipelineLayout> pipelineLayouts;
+  HandlePool<std::unique_ptr<AsyncPipeline>> pipelines;
+  // pipelines by the hash of their baked state, see PipelineDescription::hash
+  std::unordered_map<uint64_t, PipelineHandle> pipelineKeys;
+  HandlePool<std::shared_ptr<Mesh>> meshes;
+  HandlePool<std::unique_ptr<Texture>> texures;
+
+  // resolved when loaded, so recording never looks up resources by name
+  DescriptorLayoutHandle frameLayout;
+  PipelineLayoutHandle basicLayout;
+  PipelineHandle basicPipeline;
+  // draws meshes stored as PackedVertex, with the state of basicPipeline
+  PipelineHandle packedPipeline;
+  RenderState basicState;
+  MeshHandle triangleMesh;
+  // a mesh drawn for every scene object, placed by its node
+  struct SceneDraw {
+    MeshHandle mesh;
+    glm::mat4 transform {1.f};
+  };
+  std::vector<SceneDraw> sceneDraws;
 
   // engine states
+  uint32_t framesInFlight = 0;
   uint32_t currentFrame = 0;
+  uint64_t frameNumber = 0;
+  // first frame recorded with the current number of frames in flight
+  uint64_t pacingStartFrame = 0;
   bool framebufferResized = false;
   bool stop_rendering = false;
 
   // per frame objects
-  std::vector<std::unique_ptr<Command>> cmdBuffers;
+  std::vector<std::unique_ptr<CommandAllocator>> commandAllocators;
   std::vector<std::unique_ptr<Semaphore>> imageAvailableSemaphores;
   std::vector<std::unique_ptr<Semaphore>> renderFinishedSemaphores;
-  std::vector<std::unique_ptr<Fence>> inFlightFences;
-  std::vector<std::unique_ptr<Buffer>> uniformBuffers;
+  std::vector<uint64_t> frameTimelineValues;
+  // uniform data written by a frame, bound through dynamic offsets
+  std::vector<std::unique_ptr<FrameAllocator>> frameAllocators;
   std::vector<VkDescriptorSet> descriptorSets;
+  uint32_t cameraOffset = 0;
+  std::unique_ptr<ParallelRecorder> recorder;
+  RenderQueue renderQueue;
+  glm::vec3 cameraPosition {0.f, 0.f, 2.5f};
+
+  // signaled by every submission to the graphics and transfer queues
+  std::unique_ptr<TimelineSemaphore> graphicsTimeline;
+  std::unique_ptr<TimelineSemaphore> transferTimeline;
+
+  // timestamps of the passes recorded each frame
+  std::unique_ptr<GpuProfiler> gpuProfiler;
 
-  // for imediate submit
-  UploadContext uploadContext;
+  // batches uploads into one submission per frame
+  std::unique_ptr<UploadQueue> uploadQueue;
+  // upload timeline value the frame being recorded has to wait on
+  uint64_t uploadWaitValue = 0;
+  // vertex and index buffers shared by every mesh
+  std::unique_ptr<MeshPool> meshPool;
 
   void initPipelines();
+  PipelineDescription describePipeline(const PipelineBuilder& builder);
+  PipelineHandle createPipeline(const PipelineBuilder& builder, const std::string& name);
+  void initSync();
   void initFrames();
+  void destroyFrames();
   void initMeshes();
+  void loadObj(const std::string& filePath);
+  void loadGltf(const std::string& filePath);
 
+  void runHeadless();
   void drawFrame();
+  void updateUniformBuffer(const uint32_t currentFrame);
+  void updateScene();
+  void beginRendering(const VkCommandBuffer buffer, const uint32_t imageIndex, const bool secondary = false);
+  void endRendering(const VkCommandBuffer buffer, const uint32_t imageIndex);
   void recordCommandBuffer(const VkCommandBuffer buffer, const uint32_t imageIndex);
-  VkResult submitFrame(const uint32_t currentFrame, const uint32_t imageIndex);
-  void immediateSubmit(std::function<void(VkCommandBuffer cmd)>&& function);
+  void recordDraws(const VkCommandBuffer buffer, const uint32_t first, const uint32_t count);
+  VkResult submitFrame(const VkCommandBuffer buffer, const uint32_t currentFrame, const uint32_t imageIndex);
   void uploadMesh(std::shared_ptr<Mesh> mesh);
 };
 
@@ -0,0 +1,511 @@
+#include "gltf_loader.h"
+
+#include "../util/profiler.h"
+#include "../util/stb_image.h"
+#include "../util/vertex_packing.h"
+
+// images are decoded by loadImage, through the stb_image built with Texture
+#define TINYGLTF_IMPLEMENTATION
+#define TINYGLTF_NO_STB_IMAGE
+#define TINYGLTF_NO_STB_IMAGE_WRITE
+#include <tiny_gltf.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+#include <unordered_set>
+
+namespace mb {
+
+namespace {
+
+// elements of an accessor, in place in the memory of its buffer
+struct AccessorView {
+  const uint8_t* data = nullptr;
+  size_t stride = 0;
+  size_t count = 0;
+  size_t elementSize = 0;
+  int componentType = 0;
+  int type = 0;
+};
+
+// where the decoded images of a file go, see loadImage
+struct ImageTarget {
+  UploadQueue* uploads;
+  std::vector<std::unique_ptr<Texture>>* textures;
+};
+
+/**
+ * @brief locate the elements of an accessor, checking they lie within its
+ *        buffer view
+ *
+ * @param model : the file
+ * @param index : index of the accessor
+ */
+AccessorView viewAccessor(const tinygltf::Model& model, const int index) {
+  if (index < 0 || static_cast<size_t>(index) >= model.accessors.size()) {
+    throw std::runtime_error("[ERROR]: gltf accessor out of range");
+  }
+  const tinygltf::Accessor& accessor = model.accessors[index];
+  if (accessor.sparse.isSparse) {
+    throw std::runtime_error("[ERROR]: sparse gltf accessors are not supported");
+  }
+  if (accessor.bufferView < 0 || static_cast<size_t>(accessor.bufferView) >= model.bufferViews.size()) {
+    throw std::runtime_error("[ERROR]: gltf accessor without a buffer view");
+  }
+  const tinygltf::BufferView& bufferView = model.bufferViews[accessor.bufferView];
+  const tinygltf::Buffer& buffer = model.buffers.at(bufferView.buffer);
+
+  AccessorView view {};
+  view.count = accessor.count;
+  view.componentType = accessor.componentType;
+  view.type = accessor.type;
+  const int componentSize = tinygltf::GetComponentSizeInBytes(accessor.componentType);
+  const int components = tinygltf::GetNumComponentsInType(accessor.type);
+  const int stride = accessor.ByteStride(bufferView);
+  if (componentSize <= 0 || components <= 0 || stride <= 0) {
+    throw std::runtime_error("[ERROR]: gltf accessor with an invalid layout");
+  }
+  view.elementSize = static_cast<size_t>(componentSize) * static_cast<size_t>(components);
+  view.stride = static_cast<size_t>(stride);
+
+  const size_t viewEnd = std::min(bufferView.byteOffset + bufferView.byteLength, buffer.data.size());
+  const size_t begin = bufferView.byteOffset + accessor.byteOffset;
+  if (view.count > 0 && begin + view.stride * (view.count - 1) + view.elementSize > viewEnd) {
+    throw std::runtime_error("[ERROR]: gltf accessor runs past its buffer view");
+  }
+  view.data = buffer.data.data() + begin;
+  return view;
+}
+
+/**
+ * @brief read a component as a float, normalizing unsigned integers
+ *
+ */
+float readComponent(const uint8_t* data, const int componentType) {
+  switch (componentType) {
+    case TINYGLTF_COMPONENT_TYPE_FLOAT: {
+      float value;
+      std::memcpy(&value, data, sizeof(value));
+      return value;
+    }
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+      return *data / 255.f;
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: {
+      uint16_t value;
+      std::memcpy(&value, data, sizeof(value));
+      return value / 65535.f;
+    }
+    default:
+      throw std::runtime_error("[ERROR]: unsupported gltf component type");
+  }
+}
+
+/**
+ * @brief read an index as a 32 bit integer
+ *
+ */
+uint32_t readIndex(const uint8_t* data, const int componentType) {
+  switch (componentType) {
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+      return *data;
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: {
+      uint16_t value;
+      std::memcpy(&value, data, sizeof(value));
+      return value;
+    }
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT: {
+      uint32_t value;
+      std::memcpy(&value, data, sizeof(value));
+      return value;
+    }
+    default:
+      throw std::runtime_error("[ERROR]: unsupported gltf index type");
+  }
+}
+
+/**
+ * @brief read the first components of an element into a vec3, missing
+ *        components stay at their value in result
+ *
+ */
+glm::vec3 readVec3(const AccessorView& view, const size_t element, glm::vec3 result) {
+  const uint8_t* data = view.data + view.stride * element;
+  const size_t componentSize = static_cast<size_t>(tinygltf::GetComponentSizeInBytes(view.componentType));
+  const int components = std::min(tinygltf::GetNumComponentsInType(view.type), 3);
+  for (int i = 0; i < components; i++) {
+    result[i] = readComponent(data + componentSize * i, view.componentType);
+  }
+  return result;
+}
+
+/**
+ * @brief checks if an accessor holds the given member of Vertex in place,
+ *        relative to the position accessor
+ *
+ */
+bool matchesVertex(const AccessorView& positions, const AccessorView& view, const size_t offset) {
+  return view.data == positions.data + offset && view.stride == sizeof(Vertex) && view.count == positions.count
+    && view.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT && view.type == TINYGLTF_TYPE_VEC3;
+}
+
+/**
+ * @brief image callback of tinygltf, decodes the image and queues its upload
+ *        instead of keeping the pixels in the model
+ *
+ * A failed decode leaves the texture null rather than failing the file.
+ */
+bool loadImage(tinygltf::Image* image, const int imageIndex, std::string* /*error*/, std::string* warning,
+  int /*requiredWidth*/, int /*requiredHeight*/, const unsigned char* bytes, int size, void* userData) {
+  ImageTarget& target = *static_cast<ImageTarget*>(userData);
+  if (imageIndex < 0) {
+    return true;
+  }
+  if (target.textures->size() <= static_cast<size_t>(imageIndex)) {
+    target.textures->resize(imageIndex + 1);
+  }
+
+  int width, height, channels;
+  stbi_uc* pixels = stbi_load_from_memory(bytes, size, &width, &height, &channels, STBI_rgb_alpha);
+  if (!pixels) {
+    if (warning) {
+      *warning += "failed to decode image " + std::to_string(imageIndex) + " '" + image->name + "'\n";
+    }
+    return true;
+  }
+
+  image->width = width;
+  image->height = height;
+  image->component = 4;
+  image->bits = 8;
+  image->pixel_type = TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE;
+  try {
+    (*target.textures)[imageIndex] = std::make_unique<Texture>(pixels, static_cast<uint32_t>(width), static_cast<uint32_t>(height), *target.uploads);
+  }
+  catch (...) {
+    stbi_image_free(pixels);
+    throw;
+  }
+  stbi_image_free(pixels);
+  return true;
+}
+
+/**
+ * @brief local transform of a node, from its matrix or its translation,
+ *        rotation and scale
+ *
+ */
+glm::mat4 nodeTransform(const tinygltf::Node& node) {
+  if (node.matrix.size() == 16) {
+    glm::mat4 matrix;
+    for (int column = 0; column < 4; column++) {
+      for (int row = 0; row < 4; row++) {
+        matrix[column][row] = static_cast<float>(node.matrix[column * 4 + row]);
+      }
+    }
+    return matrix;
+  }
+
+  glm::mat4 transform(1.f);
+  if (node.translation.size() == 3) {
+    transform = glm::translate(transform, glm::vec3(node.translation[0], node.translation[1], node.translation[2]));
+  }
+  if (node.rotation.size() == 4) {
+    // glTF stores quaternions as x, y, z, w
+    const glm::quat rotation(
+      static_cast<float>(node.rotation[3]), static_cast<float>(node.rotation[0]),
+      static_cast<float>(node.rotation[1]), static_cast<float>(node.rotation[2])
+    );
+    transform *= glm::mat4_cast(rotation);
+  }
+  if (node.scale.size() == 3) {
+    transform = glm::scale(transform, glm::vec3(node.scale[0], node.scale[1], node.scale[2]));
+  }
+  return transform;
+}
+
+}
+
+/**
+ * @brief create the loader
+ *
+ * @param _uploads : queue the meshes and textures are uploaded through
+ * @param _meshPool : pool the meshes are placed in
+ * @param _format : layout the vertices of the meshes are stored in
+ */
+GltfLoader::GltfLoader(UploadQueue& _uploads, MeshPool& _meshPool, const VertexFormat _format) 
+  : uploads(_uploads), meshPool(_meshPool), format(_format) {}
+
+/**
+ * @brief load a .gltf or .glb file
+ *
+ * Only triangle list primitives are loaded, others are skipped with a
+ * warning.
+ *
+ * @param filePath : file to load, external buffers and images are looked up next to it
+ */
+GltfScene GltfLoader::load(const std::string& filePath) {
+  MB_PROFILE_ZONE("GltfLoader::load");
+
+  GltfScene scene;
+  ImageTarget imageTarget {&uploads, &scene.textures};
+
+  tinygltf::TinyGLTF loader;
+  loader.SetImageLoader(loadImage, &imageTarget);
+
+  std::string extension = std::filesystem::path(filePath).extension().string();
+  std::transform(extension.begin(), extension.end(), extension.begin(), [](const unsigned char c) {return std::tolower(c);});
+
+  tinygltf::Model model;
+  std::string error;
+  std::string warning;
+  const bool loaded = extension == ".glb"
+    ? loader.LoadBinaryFromFile(&model, &error, &warning, filePath)
+    : loader.LoadASCIIFromFile(&model, &error, &warning, filePath);
+  if (!warning.empty()) {
+    std::cerr << "[WARNING]: " << filePath << ": " << warning;
+  }
+  if (!loaded) {
+    throw std::runtime_error("[ERROR]: failed to load gltf file " + filePath + ": " + error);
+  }
+  scene.textures.resize(model.images.size());
+
+  // scene meshes of every primitive of each gltf mesh
+  std::vector<std::vector<uint32_t>> meshPrimitives(model.meshes.size());
+  std::unordered_set<std::string> usedNames;
+  for (size_t meshIndex = 0; meshIndex < model.meshes.size(); meshIndex++) {
+    const tinygltf::Mesh& gltfMesh = model.meshes[meshIndex];
+    // meshes are looked up by name, unnamed and repeated meshes get their index
+    std::string meshName = gltfMesh.name;
+    if (meshName.empty() || usedNames.count(meshName) > 0) {
+      meshName += "#" + std::to_string(meshIndex);
+    }
+    usedNames.insert(meshName);
+
+    for (size_t primitiveIndex = 0; primitiveIndex < gltfMesh.primitives.size(); primitiveIndex++) {
+      const tinygltf::Primitive& primitive = gltfMesh.primitives[primitiveIndex];
+      SceneMesh sceneMesh {};
+      sceneMesh.name = meshName + "/" + std::to_string(primitiveIndex);
+      sceneMesh.mesh = loadPrimitive(model, primitive);
+      if (!sceneMesh.mesh) {
+        std::cerr << "[WARNING]: " << filePath << ": skipping primitive " << sceneMesh.name << ", only triangle lists are supported\n";
+        continue;
+      }
+
+      if (primitive.material >= 0 && static_cast<size_t>(primitive.material) < model.materials.size()) {
+        const int texture = model.materials[primitive.material].pbrMetallicRoughness.baseColorTexture.index;
+        if (texture >= 0 && static_cast<size_t>(texture) < model.textures.size()) {
+          sceneMesh.baseColorTexture = model.textures[texture].source;
+        }
+      }
+
+      meshPrimitives[meshIndex].push_back(static_cast<uint32_t>(scene.meshes.size()));
+      scene.meshes.push_back(std::move(sceneMesh));
+    }
+  }
+
+  loadNodes(model, scene, meshPrimitives);
+
+  std::cout << "[INFO]: loaded " << scene.meshes.size() << " meshes, " << scene.textures.size()
+    << " textures and " << scene.nodes.size() << " nodes from " << filePath << "\n";
+  return scene;
+}
+
+/**
+ * @brief create a mesh for a primitive and queue the upload of its vertices
+ *        and indices
+ *
+ * Vertices without a normal keep a zero normal, the color is COLOR_0 times
+ * the base color factor of the material. Primitives without indices are
+ * given sequential ones.
+ *
+ * @param model : the file
+ * @param primitive : primitive to load
+ * @return std::shared_ptr<Mesh> : the mesh, null if the primitive is not a triangle list
+ */
+std::shared_ptr<Mesh> GltfLoader::loadPrimitive(const tinygltf::Model& model, const tinygltf::Primitive& primitive) {
+  if (primitive.mode != TINYGLTF_MODE_TRIANGLES) {
+    return nullptr;
+  }
+
+  // attribute accessor by name, -1 when missing
+  auto attribute = [&](const char* name) {
+    const auto it = primitive.attributes.find(name);
+    return it != primitive.attributes.end() ? it->second : -1;
+  };
+  const int positionAccessor = attribute("POSITION");
+  if (positionAccessor < 0) {
+    throw std::runtime_error("[ERROR]: gltf primitive without positions");
+  }
+  const AccessorView positions = viewAccessor(model, positionAccessor);
+  if (positions.componentType != TINYGLTF_COMPONENT_TYPE_FLOAT || positions.type != TINYGLTF_TYPE_VEC3) {
+    throw std::runtime_error("[ERROR]: gltf positions must be float vec3");
+  }
+  const int normalAccessor = attribute("NORMAL");
+  const int colorAccessor = attribute("COLOR_0");
+  AccessorView normals {};
+  AccessorView colors {};
+  if (normalAccessor >= 0) {
+    normals = viewAccessor(model, normalAccessor);
+  }
+  if (colorAccessor >= 0) {
+    colors = viewAccessor(model, colorAccessor);
+  }
+  if ((normalAccessor >= 0 && normals.count != positions.count) || (colorAccessor >= 0 && colors.count != positions.count)) {
+    throw std::runtime_error("[ERROR]: gltf attributes of a primitive differ in count");
+  }
+
+  glm::vec3 baseColor(1.f);
+  if (primitive.material >= 0 && static_cast<size_t>(primitive.material) < model.materials.size()) {
+    const auto& factor = model.materials[primitive.material].pbrMetallicRoughness.baseColorFactor;
+    if (factor.size() >= 3) {
+      baseColor = glm::vec3(factor[0], factor[1], factor[2]);
+    }
+  }
+
+  const uint32_t vertexCount = static_cast<uint32_t>(positions.count);
+  AccessorView indices {};
+  uint32_t indexCount = vertexCount;
+  // 0xffff is left free as the primitive restart index
+  VkIndexType indexType = vertexCount < UINT16_MAX ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+  if (primitive.indices >= 0) {
+    indices = viewAccessor(model, primitive.indices);
+    indexCount = static_cast<uint32_t>(indices.count);
+    // byte indices are widened, the device may not support them
+    indexType = indices.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT ? VK_INDEX_TYPE_UINT32 : VK_INDEX_TYPE_UINT16;
+
+    // an index out of range would read past the vertex buffer
+    for (size_t i = 0; i < indices.count; i++) {
+      if (readIndex(indices.data + indices.stride * i, indices.componentType) >= vertexCount) {
+        throw std::runtime_error("[ERROR]: gltf index out of range");
+      }
+    }
+  }
+
+  // packed positions are spread over the bounds of the primitive, which the
+  // position accessor has to store, only scan them when it does not
+  PositionQuantization quantization {};
+  if (format == VertexFormat::Packed && positions.count > 0) {
+    const tinygltf::Accessor& accessor = model.accessors[positionAccessor];
+    glm::vec3 min(0.f);
+    glm::vec3 max(0.f);
+    if (accessor.minValues.size() == 3 && accessor.maxValues.size() == 3) {
+      min = glm::vec3(accessor.minValues[0], accessor.minValues[1], accessor.minValues[2]);
+      max = glm::vec3(accessor.maxValues[0], accessor.maxValues[1], accessor.maxValues[2]);
+    }
+    else {
+      min = max = readVec3(positions, 0, glm::vec3(0.f));
+      for (size_t i = 1; i < positions.count; i++) {
+        const glm::vec3 position = readVec3(positions, i, glm::vec3(0.f));
+        min = glm::min(min, position);
+        max = glm::max(max, position);
+      }
+    }
+    quantization = quantizationFromBounds(min, max);
+  }
+
+  auto mesh = std::make_shared<Mesh>(vertexCount, indexCount, indexType, format, quantization);
+  mesh->allocateBuffers(meshPool);
+
+  // the file already stores interleaved vertices, copy them as they are
+  const bool vertexLayoutMatches = format == VertexFormat::Full && normalAccessor >= 0 && colorAccessor >= 0 && baseColor == glm::vec3(1.f)
+    && positions.stride == sizeof(Vertex)
+    && matchesVertex(positions, normals, offsetof(Vertex, normal) - offsetof(Vertex, pos))
+    && matchesVertex(positions, colors, offsetof(Vertex, color) - offsetof(Vertex, pos));
+  if (vertexLayoutMatches) {
+    meshPool.uploadVertices(mesh->getAllocation(), positions.data);
+  }
+  else {
+    meshPool.uploadVertices(mesh->getAllocation(), [&](void* staging) {
+      for (size_t i = 0; i < positions.count; i++) {
+        Vertex vertex {};
+        vertex.pos = readVec3(positions, i, glm::vec3(0.f));
+        vertex.normal = normalAccessor >= 0 ? readVec3(normals, i, glm::vec3(0.f)) : glm::vec3(0.f);
+        vertex.color = colorAccessor >= 0 ? baseColor * readVec3(colors, i, glm::vec3(1.f)) : baseColor;
+        if (format == VertexFormat::Packed) {
+          static_cast<PackedVertex*>(staging)[i] = packVertex(vertex.pos, vertex.normal, vertex.color, quantization);
+        }
+        else {
+          static_cast<Vertex*>(staging)[i] = vertex;
+        }
+      }
+    });
+  }
+
+  const size_t indexStride = Mesh::indexStride(indexType);
+  const bool indexLayoutMatches = primitive.indices >= 0 && indices.stride == indexStride && indices.elementSize == indexStride;
+  if (indexLayoutMatches) {
+    mesh->uploadTicket = meshPool.uploadIndices(mesh->getAllocation(), indices.data);
+  }
+  else {
+    mesh->uploadTicket = meshPool.uploadIndices(mesh->getAllocation(), [&](void* staging) {
+      for (uint32_t i = 0; i < indexCount; i++) {
+        const uint32_t index = primitive.indices >= 0 ? readIndex(indices.data + indices.stride * i, indices.componentType) : i;
+        if (indexType == VK_INDEX_TYPE_UINT16) {
+          static_cast<uint16_t*>(staging)[i] = static_cast<uint16_t>(index);
+        }
+        else {
+          static_cast<uint32_t*>(staging)[i] = index;
+        }
+      }
+    });
+  }
+
+  return mesh;
+}
+
+/**
+ * @brief copy the node hierarchy and resolve the world transform of every
+ *        node, parents before their children
+ *
+ * @param model : the file
+ * @param scene : scene the nodes are added to
+ * @param meshPrimitives : scene meshes of every gltf mesh
+ */
+void GltfLoader::loadNodes(const tinygltf::Model& model, GltfScene& scene, const std::vector<std::vector<uint32_t>>& meshPrimitives) {
+  scene.nodes.resize(model.nodes.size());
+  for (size_t i = 0; i < model.nodes.size(); i++) {
+    const tinygltf::Node& node = model.nodes[i];
+    SceneNode& sceneNode = scene.nodes[i];
+    sceneNode.name = node.name;
+    sceneNode.localTransform = nodeTransform(node);
+    if (node.mesh >= 0 && static_cast<size_t>(node.mesh) < meshPrimitives.size()) {
+      sceneNode.meshes = meshPrimitives[node.mesh];
+    }
+    for (const int child : node.children) {
+      if (child >= 0 && static_cast<size_t>(child) < model.nodes.size()) {
+        scene.nodes[child].parent = static_cast<int32_t>(i);
+      }
+    }
+  }
+
+  std::vector<uint32_t> stack;
+  for (size_t i = 0; i < scene.nodes.size(); i++) {
+    if (scene.nodes[i].parent < 0) {
+      stack.push_back(static_cast<uint32_t>(i));
+    }
+  }
+  while (!stack.empty()) {
+    const uint32_t index = stack.back();
+    stack.pop_back();
+    SceneNode& node = scene.nodes[index];
+    node.worldTransform = node.parent < 0
+      ? node.localTransform
+      : scene.nodes[node.parent].worldTransform * node.localTransform;
+
+    for (const int child : model.nodes[index].children) {
+      if (child >= 0 && static_cast<size_t>(child) < scene.nodes.size() && scene.nodes[child].parent == static_cast<int32_t>(index)) {
+        stack.push_back(static_cast<uint32_t>(child));
+      }
+    }
+  }
+}
+
+}
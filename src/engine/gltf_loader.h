@@ -0,0 +1,89 @@
+#pragma once
+
+#include "mesh.h"
+#include "mesh_pool.h"
+#include "texture.h"
+#include "../vulkan/upload_queue.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace tinygltf {
+class Model;
+struct Primitive;
+}
+
+namespace mb {
+
+/**
+ * @brief a primitive of a glTF mesh, drawn as one Mesh
+ *
+ */
+struct SceneMesh {
+  std::string name;
+  std::shared_ptr<Mesh> mesh;
+  // index into GltfScene::textures of the base color texture, -1 if none
+  int32_t baseColorTexture = -1;
+};
+
+/**
+ * @brief a node of the scene hierarchy
+ *
+ */
+struct SceneNode {
+  std::string name;
+  // index into GltfScene::nodes, -1 for a root
+  int32_t parent = -1;
+  glm::mat4 localTransform {1.f};
+  // local transform of the node and all its parents
+  glm::mat4 worldTransform {1.f};
+  // indices into GltfScene::meshes of the primitives the node draws
+  std::vector<uint32_t> meshes;
+};
+
+/**
+ * @brief meshes, textures and nodes of a glTF file, the uploads of the
+ *        meshes and textures are queued by the time it is returned
+ *
+ */
+struct GltfScene {
+  std::vector<SceneMesh> meshes;
+  // one per image of the file, null for images that failed to decode
+  std::vector<std::unique_ptr<Texture>> textures;
+  std::vector<SceneNode> nodes;
+};
+
+/**
+ * @brief loads glTF 2.0 and GLB files through tinygltf
+ *
+ * Vertices and indices go from the file's buffers straight into staging
+ * memory, copied as one range where an accessor already has the layout of
+ * Vertex or of the index type, and converted element by element while
+ * being staged otherwise, so no attribute is collected into a temporary.
+ * Images are decoded and staged as tinygltf reads them, without keeping the
+ * pixels in the model. Packed meshes are quantized while being staged, and
+ * every mesh is placed in the mesh pool.
+ */
+class GltfLoader {
+public:
+  GltfLoader(UploadQueue& _uploads, MeshPool& _meshPool, const VertexFormat _format = VertexFormat::Full);
+
+  GltfLoader (const GltfLoader&) = delete;
+  GltfLoader& operator= (const GltfLoader&) = delete;
+
+  GltfScene load(const std::string& filePath);
+
+private:
+  UploadQueue& uploads;
+  MeshPool& meshPool;
+  VertexFormat format;
+
+  std::shared_ptr<Mesh> loadPrimitive(const tinygltf::Model& model, const tinygltf::Primitive& primitive);
+  static void loadNodes(const tinygltf::Model& model, GltfScene& scene, const std::vector<std::vector<uint32_t>>& meshPrimitives);
+};
+
+}
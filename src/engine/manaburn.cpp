@@ -2,11 +2,66 @@
 
 #include "engine.h"
 
+#include <cstdlib>
+#include <string>
+
 int main(int argc, char* argv[]) {
+  mb::EngineConfig config;
+
+  // command line options
+  for (int i = 1; i < argc; i++) {
+    const std::string arg = argv[i];
+    if (arg == "--headless") {
+      config.headless = true;
+    }
+    else if (arg == "--frames" && i + 1 < argc) {
+      config.frameLimit = std::strtoull(argv[++i], nullptr, 10);
+    }
+    else if (arg == "--frames-in-flight" && i + 1 < argc) {
+      config.framesInFlight = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+    }
+    else if (arg == "--gpu-profile" && i + 1 < argc) {
+      config.gpuProfilePath = argv[++i];
+    }
+    else if (arg == "--cpu-trace" && i + 1 < argc) {
+      config.cpuTracePath = argv[++i];
+    }
+    else if (arg == "--pipeline-cache" && i + 1 < argc) {
+      config.pipelineCachePath = argv[++i];
+    }
+    else if (arg == "--no-pipeline-cache") {
+      config.pipelineCachePath.clear();
+    }
+    else if (arg == "--render-pass") {
+      config.dynamicRendering = false;
+    }
+    else if (arg == "--baked-state") {
+      config.extendedDynamicState = false;
+    }
+    else if (arg == "--record-threads" && i + 1 < argc) {
+      config.recordThreads = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+    }
+    else if (arg == "--objects" && i + 1 < argc) {
+      config.objectCount = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+    }
+    else if (arg == "--mesh" && i + 1 < argc) {
+      config.meshPaths.push_back(argv[++i]);
+    }
+    else if (arg == "--packed-vertices") {
+      config.packedVertices = true;
+    }
+    else if (arg == "--low-latency") {
+      config.framesInFlight = static_cast<uint32_t>(mb::FramePacing::LowLatency);
+    }
+    else if (arg == "--throughput") {
+      config.framesInFlight = static_cast<uint32_t>(mb::FramePacing::Throughput);
+    }
+  }
+
   mb::Engine engine;
 
-  engine.init();
+  engine.init(config);
   engine.run();
 
   return 0;
-}
\ No newline at end of file
+}
@@ -1,9 +1,186 @@
 #include "mesh.h"
 
+#include "../util/mesh_optimizer.h"
+#include "../util/vertex_packing.h"
+
+#include <cstring>
 #include <memory>
 #include <stdexcept>
+#include <utility>
 #include <vulkan/vulkan_core.h>
 
 namespace mb {
 
-}
\ No newline at end of file
+/**
+ * @brief build an indexed mesh from a triangle list with one vertex per
+ *        corner, identical corners become one shared vertex
+ * 
+ * @param vertices : three vertices per triangle
+ */
+Mesh::Mesh(const std::vector<Vertex>& vertices) : vertices(vertices) {
+  if (vertices.size() % 3 != 0) {
+    throw std::runtime_error("[ERROR]: mesh vertex count is not a multiple of 3");
+  }
+  std::vector<uint32_t> indices = deduplicateVertices(this->vertices);
+  build(indices);
+}
+
+/**
+ * @brief build an indexed mesh
+ * 
+ * @param vertices : vertices of the mesh
+ * @param indices : triangle list into the vertices
+ */
+Mesh::Mesh(std::vector<Vertex> vertices, std::vector<uint32_t> indices) : vertices(std::move(vertices)) {
+  if (indices.size() % 3 != 0) {
+    throw std::runtime_error("[ERROR]: mesh index count is not a multiple of 3");
+  }
+  for (const uint32_t index : indices) {
+    if (index >= this->vertices.size()) {
+      throw std::runtime_error("[ERROR]: mesh index out of range");
+    }
+  }
+  build(indices);
+}
+
+/**
+ * @brief take a mesh that was already built, such as one read back from a
+ *        mesh cache, without optimizing it again
+ * 
+ * @param vertices : optimized vertices
+ * @param indexData : optimized indices, stored at the size of indexType
+ * @param indexType : VK_INDEX_TYPE_UINT16 or VK_INDEX_TYPE_UINT32
+ */
+Mesh::Mesh(std::vector<Vertex> vertices, std::vector<uint8_t> indexData, const VkIndexType indexType) 
+  : vertices(std::move(vertices)), indexData(std::move(indexData)), indexType(indexType) {
+  if (indexType != VK_INDEX_TYPE_UINT16 && indexType != VK_INDEX_TYPE_UINT32) {
+    throw std::runtime_error("[ERROR]: unsupported mesh index type");
+  }
+  const uint32_t stride = indexStride(indexType);
+  if (this->indexData.size() % stride != 0) {
+    throw std::runtime_error("[ERROR]: mesh index data is not a whole number of indices");
+  }
+  numVertices = static_cast<uint32_t>(this->vertices.size());
+  numIndices = static_cast<uint32_t>(this->indexData.size() / stride);
+  if (numIndices % 3 != 0) {
+    throw std::runtime_error("[ERROR]: mesh index count is not a multiple of 3");
+  }
+  for (uint32_t i = 0; i < numIndices; i++) {
+    uint32_t index = 0;
+    if (indexType == VK_INDEX_TYPE_UINT16) {
+      uint16_t shortIndex = 0;
+      std::memcpy(&shortIndex, this->indexData.data() + i * stride, stride);
+      index = shortIndex;
+    }
+    else {
+      std::memcpy(&index, this->indexData.data() + i * stride, stride);
+    }
+    if (index >= numVertices) {
+      throw std::runtime_error("[ERROR]: mesh index out of range");
+    }
+  }
+}
+
+/**
+ * @brief a mesh with no CPU copy, allocate its buffers and write them
+ *        through the upload queue
+ * 
+ * @param vertexCount : number of vertices
+ * @param indexCount : number of indices
+ * @param indexType : VK_INDEX_TYPE_UINT16 or VK_INDEX_TYPE_UINT32
+ * @param format : layout of the vertices that will be written
+ * @param quantization : position quantization of packed vertices
+ */
+Mesh::Mesh(const uint32_t vertexCount, const uint32_t indexCount, const VkIndexType indexType,
+  const VertexFormat format, const PositionQuantization& quantization) 
+  : indexType(indexType), format(format), quantization(quantization), numVertices(vertexCount), numIndices(indexCount) {
+  if (indexType != VK_INDEX_TYPE_UINT16 && indexType != VK_INDEX_TYPE_UINT32) {
+    throw std::runtime_error("[ERROR]: unsupported mesh index type");
+  }
+  if (indexCount % 3 != 0) {
+    throw std::runtime_error("[ERROR]: mesh index count is not a multiple of 3");
+  }
+}
+
+Mesh::~Mesh() {
+  if (pool) {
+    pool->free(allocation);
+  }
+}
+
+/**
+ * @brief quantize the vertices into PackedVertex within the bounds of the
+ *        mesh, releasing the full vertices
+ * 
+ * Must be called before the buffers are allocated.
+ */
+void Mesh::pack() {
+  if (format == VertexFormat::Packed) return;
+  if (vertices.empty()) {
+    throw std::runtime_error("[ERROR]: only meshes with a CPU copy can be packed");
+  }
+
+  glm::vec3 min = vertices[0].pos;
+  glm::vec3 max = vertices[0].pos;
+  for (const Vertex& vertex : vertices) {
+    min = glm::min(min, vertex.pos);
+    max = glm::max(max, vertex.pos);
+  }
+  quantization = quantizationFromBounds(min, max);
+
+  packedVertices.resize(vertices.size());
+  for (size_t i = 0; i < vertices.size(); i++) {
+    packedVertices[i] = packVertex(vertices[i].pos, vertices[i].normal, vertices[i].color, quantization);
+  }
+  format = VertexFormat::Packed;
+  std::vector<Vertex>().swap(vertices);
+}
+
+const void* Mesh::vertexData() const {
+  if (format == VertexFormat::Packed) {
+    return packedVertices.empty() ? nullptr : packedVertices.data();
+  }
+  return data();
+}
+
+/**
+ * @brief reserve the vertex and index ranges of the mesh in a pool, written
+ *        through it by the caller
+ * 
+ * @param pool : pool the mesh lives in, must outlive the mesh
+ */
+void Mesh::allocateBuffers(MeshPool& pool) {
+  if (this->pool) {
+    throw std::runtime_error("[ERROR]: mesh buffers are already allocated");
+  }
+  allocation = pool.allocate(vertexStride(format), numVertices, indexStride(indexType), numIndices);
+  this->pool = &pool;
+}
+
+/**
+ * @brief optimize the mesh and store its indices at the smallest size that
+ *        can address every vertex
+ * 
+ */
+void Mesh::build(std::vector<uint32_t>& indices) {
+  optimizeMesh(vertices, indices);
+
+  // 0xffff is left free as the primitive restart index
+  if (vertices.size() < UINT16_MAX) {
+    indexType = VK_INDEX_TYPE_UINT16;
+    indexData.resize(indices.size() * sizeof(uint16_t));
+    uint16_t* shortIndices = reinterpret_cast<uint16_t*>(indexData.data());
+    for (size_t i = 0; i < indices.size(); i++) {
+      shortIndices[i] = static_cast<uint16_t>(indices[i]);
+    }
+  }
+  else {
+    indexType = VK_INDEX_TYPE_UINT32;
+    indexData.resize(indices.size() * sizeof(uint32_t));
+    std::memcpy(indexData.data(), indices.data(), indexData.size());
+  }
+  numVertices = static_cast<uint32_t>(vertices.size());
+  numIndices = static_cast<uint32_t>(indices.size());
+}
+
+}
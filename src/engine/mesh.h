@@ -1,9 +1,9 @@
 #pragma once
 
-#include "../util/types.h"
-#include "../util/vk_mem_alloc.h"
+#include "mesh_pool.h"
 
-#include "../vulkan/buffer.h"
+#include "../util/types.h"
+#include "../vulkan/upload_queue.h"
 
 #include <vulkan/vulkan_core.h>
 
@@ -12,19 +12,72 @@
 
 namespace mb {
 
+/**
+ * @brief indexed triangle list, optimized for the post-transform cache and
+ *        vertex fetch when built
+ * 
+ * Indices are stored as 16 bit whenever the vertex count allows it. Meshes
+ * created from counts alone keep no CPU copy, their loader writes the
+ * buffers directly. A packed mesh stores PackedVertex on the GPU, its
+ * quantization has to be handed to the shader with every draw. The GPU copy
+ * lives in a MeshPool and is given back to it when the mesh is destroyed.
+ */
 class Mesh {
 public:
   Mesh() {}
-  Mesh(std::vector<Vertex>& vertices) : vertices(vertices) {} 
+  Mesh(const std::vector<Vertex>& vertices);
+  Mesh(std::vector<Vertex> vertices, std::vector<uint32_t> indices);
+  Mesh(std::vector<Vertex> vertices, std::vector<uint8_t> indexData, const VkIndexType indexType);
+  Mesh(const uint32_t vertexCount, const uint32_t indexCount, const VkIndexType indexType,
+    const VertexFormat format = VertexFormat::Full, const PositionQuantization& quantization = {});
+  ~Mesh();
+
+  Mesh (const Mesh&) = delete;
+  Mesh& operator= (const Mesh&) = delete;
+
+  void pack();
 
-  uint32_t size() {return vertices.size() * sizeof(Vertex);}
-  uint32_t vertexCount() {return vertices.size();}
-  void copyToAllocation() {vertexBuffer.copyMemoryToAllocation(vertices.data(), size());}
+  uint32_t size() const {return numVertices * vertexStride(format);}
+  uint32_t vertexCount() const {return numVertices;}
+  // full vertices, null when the mesh keeps no CPU copy or has been packed
+  const Vertex* data() const {return vertices.empty() ? nullptr : vertices.data();}
+  // vertices in the format they are uploaded in, null when the mesh keeps no CPU copy
+  const void* vertexData() const;
+  VertexFormat getVertexFormat() const {return format;}
+  const PositionQuantization& getQuantization() const {return quantization;}
 
-  Buffer vertexBuffer;
+  uint32_t indexSize() const {return numIndices * indexStride(indexType);}
+  uint32_t indexCount() const {return numIndices;}
+  // null when the mesh keeps no CPU copy
+  const void* indices() const {return indexData.empty() ? nullptr : indexData.data();}
+  VkIndexType getIndexType() const {return indexType;}
+
+  void allocateBuffers(MeshPool& pool);
+  // invalid until the buffers are allocated
+  MeshPool::AllocationHandle getAllocation() const {return allocation;}
+
+  static uint32_t indexStride(const VkIndexType indexType) {
+    return indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+  }
+  static uint32_t vertexStride(const VertexFormat format) {
+    return format == VertexFormat::Packed ? sizeof(PackedVertex) : sizeof(Vertex);
+  }
+
+  UploadTicket uploadTicket;
 
 private:
   std::vector<Vertex> vertices;
+  std::vector<PackedVertex> packedVertices;
+  std::vector<uint8_t> indexData;
+  VkIndexType indexType = VK_INDEX_TYPE_UINT16;
+  VertexFormat format = VertexFormat::Full;
+  PositionQuantization quantization;
+  uint32_t numVertices = 0;
+  uint32_t numIndices = 0;
+  MeshPool* pool = nullptr;
+  MeshPool::AllocationHandle allocation;
+
+  void build(std::vector<uint32_t>& indices);
 };
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,377 @@
+#include "mesh_pool.h"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+namespace mb {
+
+namespace {
+
+constexpr VkBufferUsageFlags VERTEX_USAGE = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+constexpr VkBufferUsageFlags INDEX_USAGE = VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+
+/**
+ * @brief take a range from an allocator, an empty range takes nothing
+ *
+ * @return true if the range fit
+ */
+bool allocateRange(RangeAllocator& ranges, const VkDeviceSize size, const uint32_t alignment, VkDeviceSize& offset) {
+  offset = 0;
+  if (size == 0) return true;
+  const auto range = ranges.allocate(size, alignment);
+  if (!range) return false;
+  offset = *range;
+  return true;
+}
+
+}
+
+/**
+ * @brief create an empty pool, blocks are created as meshes need them
+ *
+ * @param _uploads : queue the meshes are written through
+ * @param _vertexBlockSize : size of the vertex buffer of a block
+ * @param _indexBlockSize : size of the index buffer of a block
+ */
+MeshPool::MeshPool(UploadQueue& _uploads, const VkDeviceSize _vertexBlockSize, const VkDeviceSize _indexBlockSize)
+  : uploads(_uploads), vertexBlockSize(_vertexBlockSize), indexBlockSize(_indexBlockSize) {}
+
+/**
+ * @brief reserve the vertex and index ranges of a mesh in one block
+ *
+ * @param vertexStride : size of a vertex, the vertex range is aligned to it
+ * @param vertexCount : number of vertices
+ * @param indexStride : size of an index, the index range is aligned to it
+ * @param indexCount : number of indices
+ * @return AllocationHandle : handle to resolve and free the ranges with
+ */
+MeshPool::AllocationHandle MeshPool::allocate(const uint32_t vertexStride, const uint32_t vertexCount, const uint32_t indexStride, const uint32_t indexCount) {
+  if (vertexStride == 0 || indexStride == 0) {
+    throw std::runtime_error("[ERROR]: invalid mesh stride");
+  }
+
+  Allocation allocation {};
+  allocation.vertexSize = static_cast<VkDeviceSize>(vertexStride) * vertexCount;
+  allocation.vertexStride = vertexStride;
+  allocation.indexSize = static_cast<VkDeviceSize>(indexStride) * indexCount;
+  allocation.indexStride = indexStride;
+
+  for (auto& block : blocks) {
+    if (!block->dedicated && allocateIn(*block, allocation)) {
+      return allocations.insert(allocation);
+    }
+  }
+
+  // padding up to the stride may be needed when the block already holds vertices of another format
+  const bool dedicated = allocation.vertexSize + vertexStride > vertexBlockSize || allocation.indexSize + indexStride > indexBlockSize;
+  Block& block = dedicated
+    ? createBlock(std::max<VkDeviceSize>(allocation.vertexSize, 1), std::max<VkDeviceSize>(allocation.indexSize, 1), true)
+    : createBlock(vertexBlockSize, indexBlockSize, false);
+  if (!allocateIn(block, allocation)) {
+    throw std::runtime_error("[ERROR]: failed to allocate mesh ranges");
+  }
+  return allocations.insert(allocation);
+}
+
+/**
+ * @brief give back the ranges of a mesh, they are reused once the frames
+ *        submitted so far have completed
+ *
+ */
+void MeshPool::free(const AllocationHandle handle) {
+  const Allocation* allocation = allocations.get(handle);
+  if (!allocation) return;
+
+  Block& block = *allocation->block;
+  block.freed.push_back({allocation->vertexOffset, allocation->vertexSize, allocation->indexOffset, allocation->indexSize, 0});
+  block.allocationCount--;
+  allocations.remove(handle);
+}
+
+/**
+ * @brief resolve the buffers and offsets a mesh is drawn with, they change
+ *        when its block is compacted
+ *
+ */
+MeshRange MeshPool::getRange(const AllocationHandle handle) const {
+  const Allocation& allocation = allocations[handle];
+  MeshRange range {};
+  range.vertexBuffer = allocation.block->vertexBuffer->buffer;
+  range.indexBuffer = allocation.block->indexBuffer->buffer;
+  range.vertexOffset = static_cast<int32_t>(allocation.vertexOffset / allocation.vertexStride);
+  range.firstIndex = static_cast<uint32_t>(allocation.indexOffset / allocation.indexStride);
+  return range;
+}
+
+/**
+ * @brief write the whole vertex range of a mesh
+ *
+ * @param data : vertices at the stride the range was allocated with
+ */
+UploadTicket MeshPool::uploadVertices(const AllocationHandle handle, const void* data) {
+  Allocation& allocation = allocations[handle];
+  // a copy of no bytes is invalid, the range is already complete
+  if (allocation.vertexSize == 0) {
+    return allocation.ticket;
+  }
+  allocation.ticket = uploads.uploadBuffer(allocation.block->vertexBuffer->buffer, data, allocation.vertexSize, allocation.vertexOffset);
+  return allocation.ticket;
+}
+
+/**
+ * @brief write the whole vertex range of a mesh through staging memory
+ *        filled by the caller
+ *
+ */
+UploadTicket MeshPool::uploadVertices(const AllocationHandle handle, const UploadQueue::StagingWriter& writer) {
+  Allocation& allocation = allocations[handle];
+  if (allocation.vertexSize == 0) {
+    return allocation.ticket;
+  }
+  allocation.ticket = uploads.uploadBuffer(allocation.block->vertexBuffer->buffer, allocation.vertexSize, writer, allocation.vertexOffset);
+  return allocation.ticket;
+}
+
+/**
+ * @brief write the whole index range of a mesh
+ *
+ * @param data : indices at the stride the range was allocated with
+ */
+UploadTicket MeshPool::uploadIndices(const AllocationHandle handle, const void* data) {
+  Allocation& allocation = allocations[handle];
+  if (allocation.indexSize == 0) {
+    return allocation.ticket;
+  }
+  allocation.ticket = uploads.uploadBuffer(allocation.block->indexBuffer->buffer, data, allocation.indexSize, allocation.indexOffset);
+  return allocation.ticket;
+}
+
+/**
+ * @brief write the whole index range of a mesh through staging memory
+ *        filled by the caller
+ *
+ */
+UploadTicket MeshPool::uploadIndices(const AllocationHandle handle, const UploadQueue::StagingWriter& writer) {
+  Allocation& allocation = allocations[handle];
+  if (allocation.indexSize == 0) {
+    return allocation.ticket;
+  }
+  allocation.ticket = uploads.uploadBuffer(allocation.block->indexBuffer->buffer, allocation.indexSize, writer, allocation.indexOffset);
+  return allocation.ticket;
+}
+
+/**
+ * @brief compact at most one fragmented block, whose meshes have finished
+ *        uploading, into new buffers
+ *
+ * The copies are left for recordMoves, which has to be recorded into the
+ * same frame before any draw resolved after this call.
+ */
+void MeshPool::defragment() {
+  for (auto& block : blocks) {
+    if (block->dedicated || !isFragmented(*block)) continue;
+
+    const bool uploaded = std::all_of(allocations.begin(), allocations.end(), [&](const Allocation& allocation) {
+      return allocation.block != block.get() || uploads.isComplete(allocation.ticket);
+    });
+    if (uploaded) {
+      compact(*block);
+      return;
+    }
+  }
+}
+
+/**
+ * @brief record the copies of the blocks compacted since the last frame,
+ *        made visible to vertex input
+ *
+ * The uploads the copies read are made visible to transfer by the upload
+ * queue, through its acquire barriers or the barrier ending a batch on a
+ * shared queue.
+ *
+ * @param cmd : command buffer of the graphics queue, after the acquire barriers
+ */
+void MeshPool::recordMoves(VkCommandBuffer cmd) {
+  if (moves.empty()) return;
+
+  // draws of earlier frames may still read the ranges being written
+  vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 0, nullptr);
+
+  for (const BufferMove& move : moves) {
+    vkCmdCopyBuffer(cmd, move.src, move.dst, static_cast<uint32_t>(move.regions.size()), move.regions.data());
+  }
+
+  VkMemoryBarrier barrier {};
+  barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+  vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+  moves.clear();
+}
+
+/**
+ * @brief tag the ranges freed and the buffers retired since the last
+ *        submission with its timeline value
+ *
+ * @param timelineValue : value the submission signals
+ */
+void MeshPool::release(const uint64_t timelineValue) {
+  for (auto& block : blocks) {
+    for (FreedRange& range : block->freed) {
+      if (range.timelineValue == 0) {
+        range.timelineValue = timelineValue;
+      }
+    }
+  }
+  for (RetiredBuffer& buffer : retired) {
+    if (buffer.timelineValue == 0) {
+      buffer.timelineValue = timelineValue;
+    }
+  }
+}
+
+/**
+ * @brief reuse the ranges and destroy the buffers of every submission that
+ *        has completed, along with blocks that are left empty
+ *
+ * @param completedValue : timeline value the GPU has reached
+ */
+void MeshPool::reclaim(const uint64_t completedValue) {
+  const auto isComplete = [completedValue](const uint64_t timelineValue) {
+    return timelineValue != 0 && timelineValue <= completedValue;
+  };
+
+  while (!retired.empty() && isComplete(retired.front().timelineValue)) {
+    retired.pop_front();
+  }
+
+  for (auto& block : blocks) {
+    auto& freed = block->freed;
+    for (const FreedRange& range : freed) {
+      if (isComplete(range.timelineValue)) {
+        block->vertexRanges.free(range.vertexOffset, range.vertexSize);
+        block->indexRanges.free(range.indexOffset, range.indexSize);
+      }
+    }
+    freed.erase(std::remove_if(freed.begin(), freed.end(), [&](const FreedRange& range) {return isComplete(range.timelineValue);}), freed.end());
+  }
+
+  // the first shared block is kept, so meshes coming and going do not recreate it
+  bool keptShared = false;
+  blocks.erase(std::remove_if(blocks.begin(), blocks.end(), [&](const std::unique_ptr<Block>& block) {
+    if (block->allocationCount > 0 || !block->freed.empty()) {
+      keptShared = keptShared || !block->dedicated;
+      return false;
+    }
+    if (!block->dedicated && !keptShared) {
+      keptShared = true;
+      return false;
+    }
+    return true;
+  }), blocks.end());
+}
+
+MeshPool::Block& MeshPool::createBlock(const VkDeviceSize vertexCapacity, const VkDeviceSize indexCapacity, const bool dedicated) {
+  auto block = std::make_unique<Block>();
+  block->vertexBuffer = createBuffer(VERTEX_USAGE, vertexCapacity);
+  block->indexBuffer = createBuffer(INDEX_USAGE, indexCapacity);
+  block->vertexRanges = RangeAllocator(vertexCapacity);
+  block->indexRanges = RangeAllocator(indexCapacity);
+  block->dedicated = dedicated;
+  blocks.push_back(std::move(block));
+  return *blocks.back();
+}
+
+/**
+ * @brief place both ranges of an allocation in a block, or neither
+ *
+ * @return true if both ranges fit
+ */
+bool MeshPool::allocateIn(Block& block, Allocation& allocation) {
+  if (!allocateRange(block.vertexRanges, allocation.vertexSize, allocation.vertexStride, allocation.vertexOffset)) {
+    return false;
+  }
+  if (!allocateRange(block.indexRanges, allocation.indexSize, allocation.indexStride, allocation.indexOffset)) {
+    block.vertexRanges.free(allocation.vertexOffset, allocation.vertexSize);
+    return false;
+  }
+  allocation.block = &block;
+  block.allocationCount++;
+  return true;
+}
+
+bool MeshPool::isFragmented(const Block& block) const {
+  const auto scattered = [](const RangeAllocator& ranges) {
+    return ranges.getFreeSize() - ranges.getLargestFreeRange() >= ranges.getCapacity() * DEFRAGMENT_THRESHOLD;
+  };
+  return scattered(block.vertexRanges) || scattered(block.indexRanges);
+}
+
+/**
+ * @brief move the live ranges of a block to the start of new buffers, in
+ *        the order they had, and retire the old buffers
+ *
+ * Ranges freed but still pending are dropped, nothing reads them from the
+ * new buffers.
+ */
+void MeshPool::compact(Block& block) {
+  std::vector<Allocation*> moved;
+  for (Allocation& allocation : allocations) {
+    if (allocation.block == &block) {
+      moved.push_back(&allocation);
+    }
+  }
+
+  auto vertexBuffer = createBuffer(VERTEX_USAGE, block.vertexRanges.getCapacity());
+  auto indexBuffer = createBuffer(INDEX_USAGE, block.indexRanges.getCapacity());
+  RangeAllocator vertexRanges(block.vertexRanges.getCapacity());
+  RangeAllocator indexRanges(block.indexRanges.getCapacity());
+  BufferMove vertexMove {block.vertexBuffer->buffer, vertexBuffer->buffer, {}};
+  BufferMove indexMove {block.indexBuffer->buffer, indexBuffer->buffer, {}};
+
+  // the ranges only shrink towards the start, so they always fit
+  std::sort(moved.begin(), moved.end(), [](const Allocation* a, const Allocation* b) {return a->vertexOffset < b->vertexOffset;});
+  for (Allocation* allocation : moved) {
+    const VkDeviceSize srcOffset = allocation->vertexOffset;
+    allocateRange(vertexRanges, allocation->vertexSize, allocation->vertexStride, allocation->vertexOffset);
+    if (allocation->vertexSize > 0) {
+      vertexMove.regions.push_back({srcOffset, allocation->vertexOffset, allocation->vertexSize});
+    }
+  }
+  std::sort(moved.begin(), moved.end(), [](const Allocation* a, const Allocation* b) {return a->indexOffset < b->indexOffset;});
+  for (Allocation* allocation : moved) {
+    const VkDeviceSize srcOffset = allocation->indexOffset;
+    allocateRange(indexRanges, allocation->indexSize, allocation->indexStride, allocation->indexOffset);
+    if (allocation->indexSize > 0) {
+      indexMove.regions.push_back({srcOffset, allocation->indexOffset, allocation->indexSize});
+    }
+  }
+
+  VkDeviceSize movedSize = 0;
+  for (const BufferMove* move : {&vertexMove, &indexMove}) {
+    for (const VkBufferCopy& region : move->regions) {
+      movedSize += region.size;
+    }
+    if (!move->regions.empty()) {
+      moves.push_back(*move);
+    }
+  }
+  std::cout << "[INFO]: compacted a mesh block, moving " << moved.size() << " meshes, " << movedSize / 1024 << " KB\n";
+
+  retired.push_back({std::move(block.vertexBuffer), 0});
+  retired.push_back({std::move(block.indexBuffer), 0});
+  block.vertexBuffer = std::move(vertexBuffer);
+  block.indexBuffer = std::move(indexBuffer);
+  block.vertexRanges = std::move(vertexRanges);
+  block.indexRanges = std::move(indexRanges);
+  block.freed.clear();
+}
+
+std::unique_ptr<Buffer> MeshPool::createBuffer(const VkBufferUsageFlags usage, const VkDeviceSize size) {
+  auto buffer = std::make_unique<Buffer>();
+  buffer->allocateBuffer(usage, VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, 0, size);
+  return buffer;
+}
+
+}
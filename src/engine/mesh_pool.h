@@ -0,0 +1,136 @@
+#pragma once
+
+#include "../util/handle_pool.h"
+#include "../util/range_allocator.h"
+#include "../vulkan/buffer.h"
+#include "../vulkan/upload_queue.h"
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include <vulkan/vulkan_core.h>
+
+namespace mb {
+
+/**
+ * @brief where the vertices and indices of a mesh are, in the form
+ *        vkCmdDrawIndexed takes them
+ *
+ */
+struct MeshRange {
+  VkBuffer vertexBuffer = VK_NULL_HANDLE;
+  VkBuffer indexBuffer = VK_NULL_HANDLE;
+  int32_t vertexOffset = 0;
+  uint32_t firstIndex = 0;
+};
+
+/**
+ * @brief suballocates the vertices and indices of every mesh from a few
+ *        large device local buffers, so draws of different meshes share
+ *        one vertex and index buffer bind
+ *
+ * Each block pairs a vertex buffer with an index buffer, meshes larger than
+ * a block get a block of their own. Vertex ranges are aligned to the vertex
+ * stride and index ranges to the index size, so a range maps to a whole
+ * vertexOffset and firstIndex. Freed ranges are only reused once the frames
+ * that may still draw from them have completed. A block whose free space
+ * has fallen apart is compacted into new buffers by copies recorded on the
+ * graphics queue, the old buffers are destroyed once the frame that copied
+ * from them completes. Only used from the thread recording the frames.
+ */
+class MeshPool {
+private:
+  struct Block;
+  struct Allocation {
+    Block* block;
+    VkDeviceSize vertexOffset;
+    VkDeviceSize vertexSize;
+    uint32_t vertexStride;
+    VkDeviceSize indexOffset;
+    VkDeviceSize indexSize;
+    uint32_t indexStride;
+    // last upload written to the ranges
+    UploadTicket ticket;
+  };
+
+public:
+  using AllocationHandle = Handle<Allocation>;
+
+  MeshPool(UploadQueue& _uploads, const VkDeviceSize _vertexBlockSize = 64 * 1024 * 1024, const VkDeviceSize _indexBlockSize = 32 * 1024 * 1024);
+
+  MeshPool (const MeshPool&) = delete;
+  MeshPool& operator= (const MeshPool&) = delete;
+
+  AllocationHandle allocate(const uint32_t vertexStride, const uint32_t vertexCount, const uint32_t indexStride, const uint32_t indexCount);
+  void free(const AllocationHandle handle);
+  MeshRange getRange(const AllocationHandle handle) const;
+
+  UploadTicket uploadVertices(const AllocationHandle handle, const void* data);
+  UploadTicket uploadVertices(const AllocationHandle handle, const UploadQueue::StagingWriter& writer);
+  UploadTicket uploadIndices(const AllocationHandle handle, const void* data);
+  UploadTicket uploadIndices(const AllocationHandle handle, const UploadQueue::StagingWriter& writer);
+
+  // once per frame, before the draws are resolved with getRange
+  void defragment();
+  // outside of rendering, before the draws
+  void recordMoves(VkCommandBuffer cmd);
+  void release(const uint64_t timelineValue);
+  void reclaim(const uint64_t completedValue);
+
+private:
+  // a block is compacted once the free space outside its largest free range
+  // reaches this share of its capacity
+  static constexpr float DEFRAGMENT_THRESHOLD = 0.25f;
+
+  // ranges freed by a mesh, reusable once timelineValue completes, 0 until
+  // the next submission is released
+  struct FreedRange {
+    VkDeviceSize vertexOffset;
+    VkDeviceSize vertexSize;
+    VkDeviceSize indexOffset;
+    VkDeviceSize indexSize;
+    uint64_t timelineValue;
+  };
+
+  struct Block {
+    std::unique_ptr<Buffer> vertexBuffer;
+    std::unique_ptr<Buffer> indexBuffer;
+    RangeAllocator vertexRanges;
+    RangeAllocator indexRanges;
+    // holds a single mesh larger than the block size
+    bool dedicated = false;
+    uint32_t allocationCount = 0;
+    std::vector<FreedRange> freed;
+  };
+
+  // buffers replaced by a compaction, destroyed once timelineValue completes
+  struct RetiredBuffer {
+    std::unique_ptr<Buffer> buffer;
+    uint64_t timelineValue;
+  };
+
+  // copies of a compaction, recorded into the next frame
+  struct BufferMove {
+    VkBuffer src;
+    VkBuffer dst;
+    std::vector<VkBufferCopy> regions;
+  };
+
+  UploadQueue& uploads;
+  VkDeviceSize vertexBlockSize;
+  VkDeviceSize indexBlockSize;
+  std::vector<std::unique_ptr<Block>> blocks;
+  HandlePool<Allocation> allocations;
+  std::deque<RetiredBuffer> retired;
+  std::vector<BufferMove> moves;
+
+  Block& createBlock(const VkDeviceSize vertexCapacity, const VkDeviceSize indexCapacity, const bool dedicated);
+  bool allocateIn(Block& block, Allocation& allocation);
+  bool isFragmented(const Block& block) const;
+  void compact(Block& block);
+  static std::unique_ptr<Buffer> createBuffer(const VkBufferUsageFlags usage, const VkDeviceSize size);
+};
+
+}
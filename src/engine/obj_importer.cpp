@@ -0,0 +1,735 @@
+#include "obj_importer.h"
+
+#include "../util/hash.h"
+#include "../util/mapped_file.h"
+#include "../util/mesh_optimizer.h"
+#include "../util/profiler.h"
+
+#include <tiny_obj_loader.h>
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+namespace mb {
+
+namespace {
+
+// vertices of a range of triangles of one shape, merged within the range
+struct Chunk {
+  size_t shape;
+  std::vector<Vertex> vertices;
+  std::vector<uint32_t> indices;
+};
+
+// material of the faces before a chunk's first usemtl, known once the
+// chunks before it are merged
+constexpr int INHERITED_MATERIAL = -1;
+
+// faces of a chunk up to the next o or g line
+struct FaceGroup {
+  // opened by an o or g line, a group without one continues the shape of the previous chunk
+  bool startsShape = false;
+  std::string name;
+  // three corners per triangle, with absolute position and normal indices
+  std::vector<tinyobj::index_t> indices;
+  // per triangle, into ParsedChunk::materialNames or INHERITED_MATERIAL
+  std::vector<int> materials;
+};
+
+// the faces and names a chunk of the text declared, its vertices are
+// written straight into the shared attributes
+struct ParsedChunk {
+  std::vector<FaceGroup> groups;
+  std::vector<std::string> materialNames;
+  std::vector<std::string> materialLibraries;
+  // material active at the end of the chunk
+  int lastMaterial = INHERITED_MATERIAL;
+  bool hasColors = false;
+};
+
+// number of v and vn lines of a chunk
+struct AttributeCounts {
+  size_t positions = 0;
+  size_t normals = 0;
+};
+
+/**
+ * @brief split off the next line of a chunk, without its line ending,
+ *        comment and surrounding whitespace
+ *
+ */
+std::string_view nextLine(std::string_view& text) {
+  const size_t end = text.find('\n');
+  std::string_view line = text.substr(0, end);
+  text.remove_prefix(end == std::string_view::npos ? text.size() : end + 1);
+
+  const size_t comment = line.find('#');
+  if (comment != std::string_view::npos) {
+    line = line.substr(0, comment);
+  }
+  const size_t first = line.find_first_not_of(" \t\r");
+  if (first == std::string_view::npos) return {};
+  const size_t last = line.find_last_not_of(" \t\r");
+  return line.substr(first, last - first + 1);
+}
+
+/**
+ * @brief split off the next whitespace separated token of a line
+ *
+ */
+std::string_view nextToken(std::string_view& line) {
+  const size_t first = line.find_first_not_of(" \t");
+  if (first == std::string_view::npos) {
+    line = {};
+    return {};
+  }
+  line.remove_prefix(first);
+  const size_t end = line.find_first_of(" \t");
+  const std::string_view token = line.substr(0, end);
+  line.remove_prefix(end == std::string_view::npos ? line.size() : end);
+  return token;
+}
+
+float parseFloat(std::string_view token) {
+  // from_chars takes no explicit plus sign
+  if (!token.empty() && token.front() == '+') {
+    token.remove_prefix(1);
+  }
+  float value = 0.f;
+  const auto [end, error] = std::from_chars(token.data(), token.data() + token.size(), value);
+  if (error != std::errc() || end != token.data() + token.size()) {
+    throw std::runtime_error("[ERROR]: malformed obj number: " + std::string(token));
+  }
+  return value;
+}
+
+/**
+ * @brief resolve a 1 based or negative, relative, OBJ index
+ *
+ * @param token : the index as written, empty if the corner has none
+ * @param count : number of elements declared before the line
+ * @return int : 0 based index, -1 if the token is empty
+ */
+int resolveIndex(const std::string_view token, const size_t count) {
+  if (token.empty()) return -1;
+  int value = 0;
+  const auto [end, error] = std::from_chars(token.data(), token.data() + token.size(), value);
+  if (error != std::errc() || end != token.data() + token.size() || value == 0) {
+    throw std::runtime_error("[ERROR]: malformed obj index: " + std::string(token));
+  }
+  return value > 0 ? value - 1 : static_cast<int>(count) + value;
+}
+
+/**
+ * @brief count the positions and normals declared by a chunk, so every
+ *        chunk knows where its own start before any of them is parsed
+ *
+ */
+AttributeCounts countAttributes(std::string_view text) {
+  AttributeCounts counts {};
+  while (!text.empty()) {
+    std::string_view line = nextLine(text);
+    const std::string_view keyword = nextToken(line);
+    if (keyword == "v") {
+      counts.positions++;
+    }
+    else if (keyword == "vn") {
+      counts.normals++;
+    }
+  }
+  return counts;
+}
+
+/**
+ * @brief parse a chunk of OBJ text that starts and ends on line boundaries
+ *
+ * Positions, colors and normals are written into attrib at the offsets the
+ * counting pass gave the chunk. Faces are triangulated as fans, texture
+ * coordinates and other statements are skipped.
+ *
+ * @param text : the chunk
+ * @param base : positions and normals declared by the chunks before it
+ * @param attrib : shared attributes, already sized for the whole file
+ */
+ParsedChunk parseChunk(std::string_view text, const AttributeCounts base, tinyobj::attrib_t& attrib) {
+  ParsedChunk chunk {};
+  chunk.groups.emplace_back();
+  AttributeCounts count = base;
+  int material = INHERITED_MATERIAL;
+  std::vector<tinyobj::index_t> corners;
+
+  while (!text.empty()) {
+    std::string_view line = nextLine(text);
+    const std::string_view keyword = nextToken(line);
+    if (keyword.empty()) continue;
+
+    if (keyword == "v") {
+      float* position = &attrib.vertices[count.positions * 3];
+      float* color = &attrib.colors[count.positions * 3];
+      for (size_t i = 0; i < 3; i++) {
+        position[i] = parseFloat(nextToken(line));
+      }
+      // x y z r g b, a fourth value alone is a weight
+      std::string_view red = nextToken(line);
+      std::string_view green = nextToken(line);
+      std::string_view blue = nextToken(line);
+      if (!blue.empty()) {
+        color[0] = parseFloat(red);
+        color[1] = parseFloat(green);
+        color[2] = parseFloat(blue);
+        chunk.hasColors = true;
+      }
+      count.positions++;
+    }
+    else if (keyword == "vn") {
+      float* normal = &attrib.normals[count.normals * 3];
+      for (size_t i = 0; i < 3; i++) {
+        normal[i] = parseFloat(nextToken(line));
+      }
+      count.normals++;
+    }
+    else if (keyword == "f") {
+      corners.clear();
+      for (std::string_view token = nextToken(line); !token.empty(); token = nextToken(line)) {
+        // v, v/vt, v//vn or v/vt/vn
+        const size_t firstSlash = token.find('/');
+        const size_t secondSlash = firstSlash == std::string_view::npos ? std::string_view::npos : token.find('/', firstSlash + 1);
+        tinyobj::index_t corner {};
+        corner.vertex_index = resolveIndex(token.substr(0, firstSlash), count.positions);
+        corner.normal_index = secondSlash == std::string_view::npos ? -1 : resolveIndex(token.substr(secondSlash + 1), count.normals);
+        corner.texcoord_index = -1;
+        corners.push_back(corner);
+      }
+      FaceGroup& group = chunk.groups.back();
+      for (size_t corner = 2; corner < corners.size(); corner++) {
+        group.indices.push_back(corners[0]);
+        group.indices.push_back(corners[corner - 1]);
+        group.indices.push_back(corners[corner]);
+        group.materials.push_back(material);
+      }
+    }
+    else if (keyword == "o" || keyword == "g") {
+      FaceGroup group {};
+      group.startsShape = true;
+      group.name = std::string(line.substr(std::min(line.find_first_not_of(" \t"), line.size())));
+      chunk.groups.push_back(std::move(group));
+    }
+    else if (keyword == "usemtl") {
+      const std::string name(line.substr(std::min(line.find_first_not_of(" \t"), line.size())));
+      const auto it = std::find(chunk.materialNames.begin(), chunk.materialNames.end(), name);
+      material = static_cast<int>(it - chunk.materialNames.begin());
+      if (it == chunk.materialNames.end()) {
+        chunk.materialNames.push_back(name);
+      }
+    }
+    else if (keyword == "mtllib") {
+      for (std::string_view library = nextToken(line); !library.empty(); library = nextToken(line)) {
+        chunk.materialLibraries.emplace_back(library);
+      }
+    }
+  }
+
+  chunk.lastMaterial = material;
+  return chunk;
+}
+
+/**
+ * @brief read the material libraries the file named, relative to its folder
+ *
+ * @return std::unordered_map<std::string, int> : material ids by name
+ */
+std::unordered_map<std::string, int> loadMaterials(const std::string& filePath, const std::vector<ParsedChunk>& chunks,
+  std::vector<tinyobj::material_t>& materials) {
+  std::map<std::string, int> materialIds;
+  std::unordered_set<std::string> loaded;
+  for (const ParsedChunk& chunk : chunks) {
+    for (const std::string& library : chunk.materialLibraries) {
+      if (!loaded.insert(library).second) continue;
+
+      const std::filesystem::path libraryPath = std::filesystem::path(filePath).parent_path() / library;
+      std::ifstream stream(libraryPath);
+      if (!stream) {
+        std::cerr << "[WARNING]: " << filePath << ": material library " << libraryPath.string() << " not found\n";
+        continue;
+      }
+      std::string warning;
+      std::string error;
+      tinyobj::LoadMtl(&materialIds, &materials, &stream, &warning, &error);
+      if (!warning.empty() || !error.empty()) {
+        std::cerr << "[WARNING]: " << libraryPath.string() << ": " << warning << error;
+      }
+    }
+  }
+  return {materialIds.begin(), materialIds.end()};
+}
+
+/**
+ * @brief join the face groups of the chunks into shapes, in file order
+ *
+ * Shapes are opened by o and g lines like tinyobjloader does, and shapes
+ * without faces are dropped.
+ */
+std::vector<tinyobj::shape_t> mergeShapes(std::vector<ParsedChunk>& chunks, const std::unordered_map<std::string, int>& materialIds) {
+  std::vector<tinyobj::shape_t> shapes(1);
+  int material = -1;
+  for (ParsedChunk& chunk : chunks) {
+    std::vector<int> chunkMaterials;
+    for (const std::string& name : chunk.materialNames) {
+      const auto it = materialIds.find(name);
+      chunkMaterials.push_back(it != materialIds.end() ? it->second : -1);
+    }
+
+    for (FaceGroup& group : chunk.groups) {
+      if (group.startsShape) {
+        if (!shapes.back().mesh.indices.empty()) {
+          shapes.emplace_back();
+        }
+        shapes.back().name = std::move(group.name);
+      }
+
+      tinyobj::mesh_t& mesh = shapes.back().mesh;
+      mesh.indices.insert(mesh.indices.end(), group.indices.begin(), group.indices.end());
+      mesh.num_face_vertices.resize(mesh.indices.size() / 3, 3);
+      for (const int faceMaterial : group.materials) {
+        mesh.material_ids.push_back(faceMaterial == INHERITED_MATERIAL ? material : chunkMaterials[faceMaterial]);
+      }
+      group = {};
+    }
+    if (chunk.lastMaterial != INHERITED_MATERIAL) {
+      material = chunkMaterials[chunk.lastMaterial];
+    }
+  }
+
+  if (shapes.back().mesh.indices.empty()) {
+    shapes.pop_back();
+  }
+  return shapes;
+}
+
+/**
+ * @brief wait for every task before returning, so none is left running on
+ *        data the caller is about to free, then rethrow the first failure
+ *
+ */
+template<typename T>
+std::vector<T> waitAll(std::vector<std::future<T>>& tasks) {
+  std::vector<T> results;
+  results.reserve(tasks.size());
+  std::exception_ptr error;
+  for (auto& task : tasks) {
+    try {
+      results.push_back(task.get());
+    }
+    catch (...) {
+      if (!error) {
+        error = std::current_exception();
+      }
+    }
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+  return results;
+}
+
+/**
+ * @brief turn -0 into 0, vertices are merged by comparing their bytes
+ *
+ */
+glm::vec3 canonical(const glm::vec3& value) {
+  return value + glm::vec3(0.f);
+}
+
+/**
+ * @brief turn a range of triangles into vertices, one per corner, and merge
+ *        the identical ones
+ *
+ * Corners without a normal take the normal of their face, the color is the
+ * vertex color times the diffuse color of the face's material.
+ *
+ * @param attrib : positions, normals and colors of the file
+ * @param materials : materials of the file
+ * @param mesh : triangulated faces of the shape
+ * @param first : first triangle of the range
+ * @param count : number of triangles in the range
+ */
+Chunk assembleChunk(const tinyobj::attrib_t& attrib, const std::vector<tinyobj::material_t>& materials,
+  const tinyobj::mesh_t& mesh, const size_t first, const size_t count) {
+  const size_t positionCount = attrib.vertices.size() / 3;
+  const size_t normalCount = attrib.normals.size() / 3;
+  const bool hasColors = attrib.colors.size() == attrib.vertices.size();
+
+  Chunk chunk {};
+  chunk.vertices.resize(count * 3);
+  for (size_t triangle = 0; triangle < count; triangle++) {
+    const size_t face = first + triangle;
+    glm::vec3 diffuse(1.f);
+    if (face < mesh.material_ids.size() && mesh.material_ids[face] >= 0
+        && static_cast<size_t>(mesh.material_ids[face]) < materials.size()) {
+      const auto& material = materials[mesh.material_ids[face]];
+      diffuse = glm::vec3(material.diffuse[0], material.diffuse[1], material.diffuse[2]);
+    }
+
+    Vertex* corners = &chunk.vertices[triangle * 3];
+    bool missingNormal = false;
+    for (size_t corner = 0; corner < 3; corner++) {
+      const tinyobj::index_t& index = mesh.indices[face * 3 + corner];
+      if (index.vertex_index < 0 || static_cast<size_t>(index.vertex_index) >= positionCount) {
+        throw std::runtime_error("[ERROR]: obj face references a missing position");
+      }
+      const size_t position = static_cast<size_t>(index.vertex_index) * 3;
+      corners[corner].pos = canonical(glm::vec3(attrib.vertices[position], attrib.vertices[position + 1], attrib.vertices[position + 2]));
+      corners[corner].color = canonical(hasColors
+        ? diffuse * glm::vec3(attrib.colors[position], attrib.colors[position + 1], attrib.colors[position + 2])
+        : diffuse);
+
+      if (index.normal_index >= 0 && static_cast<size_t>(index.normal_index) < normalCount) {
+        const size_t normal = static_cast<size_t>(index.normal_index) * 3;
+        corners[corner].normal = canonical(glm::vec3(attrib.normals[normal], attrib.normals[normal + 1], attrib.normals[normal + 2]));
+      }
+      else {
+        missingNormal = true;
+      }
+    }
+
+    if (missingNormal) {
+      const glm::vec3 cross = glm::cross(corners[1].pos - corners[0].pos, corners[2].pos - corners[0].pos);
+      const float length = glm::length(cross);
+      const glm::vec3 faceNormal = length > 0.f ? canonical(cross / length) : glm::vec3(0.f);
+      for (size_t corner = 0; corner < 3; corner++) {
+        const tinyobj::index_t& index = mesh.indices[face * 3 + corner];
+        if (index.normal_index < 0 || static_cast<size_t>(index.normal_index) >= normalCount) {
+          corners[corner].normal = faceNormal;
+        }
+      }
+    }
+  }
+
+  chunk.indices = deduplicateVertices(chunk.vertices);
+  return chunk;
+}
+
+}
+
+/**
+ * @brief create the importer
+ *
+ * @param _threadPool : workers the faces and meshes are built on
+ */
+ObjImporter::ObjImporter(ThreadPool& _threadPool) : threadPool(_threadPool) {}
+
+/**
+ * @brief import an OBJ file, from its cache when the cache was built from
+ *        the same file
+ *
+ * @param filePath : OBJ file, materials are looked up next to it
+ * @return std::vector<ImportedMesh> : a mesh per object or group with faces
+ */
+std::vector<ImportedMesh> ObjImporter::load(const std::string& filePath) {
+  MB_PROFILE_ZONE("ObjImporter::load");
+
+  const SourceKey key = makeKey(filePath);
+  const std::string cachePath = filePath + ".mbmesh";
+
+  std::vector<ImportedMesh> meshes = readCache(cachePath, key);
+  if (!meshes.empty()) {
+    return meshes;
+  }
+
+  meshes = parse(filePath);
+  writeCache(cachePath, key, meshes);
+  return meshes;
+}
+
+/**
+ * @brief size, modification time and hash of the source, the file is hashed
+ *        in chunks across the thread pool
+ *
+ * @param filePath : source file
+ */
+ObjImporter::SourceKey ObjImporter::makeKey(const std::string& filePath) {
+  MB_PROFILE_ZONE("ObjImporter::makeKey");
+
+  std::error_code error;
+  const auto modifiedTime = std::filesystem::last_write_time(filePath, error);
+  if (error) {
+    throw std::runtime_error("[ERROR]: failed to open obj file: " + filePath);
+  }
+
+  const MappedFile file(filePath);
+  const uint8_t* data = static_cast<const uint8_t*>(file.data());
+
+  std::vector<std::future<uint64_t>> tasks;
+  for (size_t offset = 0; offset < file.size(); offset += HASH_CHUNK_SIZE) {
+    const size_t size = std::min(HASH_CHUNK_SIZE, file.size() - offset);
+    tasks.push_back(threadPool.submit([data, offset, size]() {
+      return fnv1a(data + offset, size);
+    }));
+  }
+  const std::vector<uint64_t> chunkHashes = waitAll(tasks);
+
+  SourceKey key {};
+  key.size = file.size();
+  key.modifiedTime = static_cast<int64_t>(modifiedTime.time_since_epoch().count());
+  key.hash = fnv1a(chunkHashes.data(), chunkHashes.size() * sizeof(uint64_t));
+  return key;
+}
+
+/**
+ * @brief parse the text of the file and build its meshes
+ *
+ * The text is split into chunks of PARSE_CHUNK_SIZE on line boundaries.
+ * A first pass counts the positions and normals of every chunk, so the
+ * second can parse all chunks at once, resolving relative indices and
+ * writing attributes at their final offsets. The face groups of the chunks
+ * are then joined into shapes in file order.
+ *
+ * Faces are assembled in chunks of CHUNK_TRIANGLES, vertices shared across
+ * two chunks are not merged. The merged chunks of every shape are then
+ * built into a mesh, one task per mesh.
+ *
+ * @param filePath : OBJ file
+ */
+std::vector<ImportedMesh> ObjImporter::parse(const std::string& filePath) {
+  MB_PROFILE_ZONE("ObjImporter::parse");
+
+  const MappedFile file(filePath);
+  const std::string_view text(static_cast<const char*>(file.data()), file.size());
+
+  std::vector<std::string_view> textChunks;
+  for (size_t offset = 0; offset < text.size();) {
+    size_t end = std::min(offset + PARSE_CHUNK_SIZE, text.size());
+    end = std::min(text.find('\n', end), text.size());
+    if (end < text.size()) end++;
+    textChunks.push_back(text.substr(offset, end - offset));
+    offset = end;
+  }
+
+  std::vector<std::future<AttributeCounts>> countTasks;
+  for (const std::string_view chunk : textChunks) {
+    countTasks.push_back(threadPool.submit([chunk]() {return countAttributes(chunk);}));
+  }
+  const std::vector<AttributeCounts> counts = waitAll(countTasks);
+
+  std::vector<AttributeCounts> bases(counts.size());
+  AttributeCounts total {};
+  for (size_t i = 0; i < counts.size(); i++) {
+    bases[i] = total;
+    total.positions += counts[i].positions;
+    total.normals += counts[i].normals;
+  }
+
+  tinyobj::attrib_t attrib;
+  attrib.vertices.resize(total.positions * 3);
+  attrib.colors.assign(total.positions * 3, 1.f);
+  attrib.normals.resize(total.normals * 3);
+
+  std::vector<std::future<ParsedChunk>> parseTasks;
+  for (size_t i = 0; i < textChunks.size(); i++) {
+    parseTasks.push_back(threadPool.submit([chunk = textChunks[i], base = bases[i], &attrib]() {
+      return parseChunk(chunk, base, attrib);
+    }));
+  }
+  std::vector<ParsedChunk> parsed = waitAll(parseTasks);
+
+  // colors are only kept when the file has any
+  if (std::none_of(parsed.begin(), parsed.end(), [](const ParsedChunk& chunk) {return chunk.hasColors;})) {
+    attrib.colors.clear();
+  }
+
+  std::vector<tinyobj::material_t> materials;
+  const std::unordered_map<std::string, int> materialIds = loadMaterials(filePath, parsed, materials);
+  const std::vector<tinyobj::shape_t> shapes = mergeShapes(parsed, materialIds);
+  parsed.clear();
+
+  std::vector<std::future<Chunk>> chunkTasks;
+  for (size_t shape = 0; shape < shapes.size(); shape++) {
+    const tinyobj::mesh_t& mesh = shapes[shape].mesh;
+    const size_t triangleCount = mesh.indices.size() / 3;
+    for (size_t first = 0; first < triangleCount; first += CHUNK_TRIANGLES) {
+      const size_t count = std::min(CHUNK_TRIANGLES, triangleCount - first);
+      chunkTasks.push_back(threadPool.submit([&attrib, &materials, &mesh, shape, first, count]() {
+        Chunk chunk = assembleChunk(attrib, materials, mesh, first, count);
+        chunk.shape = shape;
+        return chunk;
+      }));
+    }
+  }
+  std::vector<Chunk> chunks = waitAll(chunkTasks);
+
+  // chunks of a shape are contiguous, join them into one triangle list
+  std::vector<std::future<std::shared_ptr<Mesh>>> meshTasks;
+  std::vector<std::string> names;
+  std::unordered_set<std::string> usedNames;
+  for (size_t begin = 0; begin < chunks.size();) {
+    const size_t shape = chunks[begin].shape;
+    size_t end = begin;
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+    for (; end < chunks.size() && chunks[end].shape == shape; end++) {
+      const uint32_t base = static_cast<uint32_t>(vertices.size());
+      vertices.insert(vertices.end(), chunks[end].vertices.begin(), chunks[end].vertices.end());
+      for (const uint32_t index : chunks[end].indices) {
+        indices.push_back(base + index);
+      }
+      chunks[end] = {};
+    }
+    begin = end;
+
+    // meshes are looked up by name, unnamed and repeated shapes get their index
+    std::string name = shapes[shape].name;
+    if (name.empty() || usedNames.count(name) > 0) {
+      name += "#" + std::to_string(shape);
+    }
+    usedNames.insert(name);
+    names.push_back(std::move(name));
+
+    meshTasks.push_back(threadPool.submit([vertices = std::move(vertices), indices = std::move(indices)]() mutable {
+      return std::make_shared<Mesh>(std::move(vertices), std::move(indices));
+    }));
+  }
+  std::vector<std::shared_ptr<Mesh>> built = waitAll(meshTasks);
+
+  std::vector<ImportedMesh> meshes;
+  for (size_t i = 0; i < built.size(); i++) {
+    meshes.push_back({std::move(names[i]), std::move(built[i])});
+  }
+  std::cout << "[INFO]: imported " << meshes.size() << " meshes from " << filePath << "\n";
+  return meshes;
+}
+
+/**
+ * @brief read the meshes back from the cache
+ *
+ * @param cachePath : cache file
+ * @param key : the source the cache has to be built from
+ * @return std::vector<ImportedMesh> : the meshes, empty if the cache is
+ *                                     missing, stale or corrupt
+ */
+std::vector<ImportedMesh> ObjImporter::readCache(const std::string& cachePath, const SourceKey& key) {
+  MB_PROFILE_ZONE("ObjImporter::readCache");
+
+  std::error_code error;
+  if (!std::filesystem::is_regular_file(cachePath, error)) {
+    return {};
+  }
+  const MappedFile file(cachePath);
+  const uint8_t* data = static_cast<const uint8_t*>(file.data());
+  size_t offset = 0;
+
+  // copy the next bytes of the file, false when the file is too short
+  auto read = [&](void* destination, const size_t size) {
+    if (size > file.size() - offset) {
+      return false;
+    }
+    if (size > 0) {
+      std::memcpy(destination, data + offset, size);
+    }
+    offset += size;
+    return true;
+  };
+
+  FileHeader header {};
+  if (!read(&header, sizeof(header)) || header.magic != FILE_MAGIC || header.version != FILE_VERSION
+      || header.vertexSize != sizeof(Vertex)) {
+    std::cout << "[INFO]: discarding unrecognized mesh cache " << cachePath << "\n";
+    return {};
+  }
+  if (header.source.size != key.size || header.source.modifiedTime != key.modifiedTime || header.source.hash != key.hash) {
+    std::cout << "[INFO]: discarding stale mesh cache " << cachePath << "\n";
+    return {};
+  }
+
+  std::vector<ImportedMesh> meshes;
+  try {
+    for (uint32_t i = 0; i < header.meshCount; i++) {
+      MeshHeader meshHeader {};
+      if (!read(&meshHeader, sizeof(meshHeader)) || meshHeader.vertexCount > (file.size() - offset) / sizeof(Vertex)) {
+        throw std::runtime_error("truncated");
+      }
+      std::string name(meshHeader.nameSize, '\0');
+      std::vector<Vertex> vertices(meshHeader.vertexCount);
+      if (!read(name.data(), name.size()) || !read(vertices.data(), vertices.size() * sizeof(Vertex))
+          || meshHeader.indexSize > file.size() - offset) {
+        throw std::runtime_error("truncated");
+      }
+      std::vector<uint8_t> indexData(meshHeader.indexSize);
+      read(indexData.data(), indexData.size());
+
+      meshes.push_back({std::move(name),
+        std::make_shared<Mesh>(std::move(vertices), std::move(indexData), static_cast<VkIndexType>(meshHeader.indexType))});
+    }
+  }
+  catch (const std::exception&) {
+    std::cout << "[INFO]: discarding corrupt mesh cache " << cachePath << "\n";
+    return {};
+  }
+
+  std::cout << "[INFO]: loaded " << meshes.size() << " meshes from " << cachePath << "\n";
+  return meshes;
+}
+
+/**
+ * @brief write the built meshes to the cache, through a temporary file so an
+ *        interrupted write never leaves a truncated cache behind
+ *
+ * @param cachePath : cache file
+ * @param key : the source the meshes were built from
+ * @param meshes : meshes to write
+ */
+void ObjImporter::writeCache(const std::string& cachePath, const SourceKey& key, const std::vector<ImportedMesh>& meshes) {
+  MB_PROFILE_ZONE("ObjImporter::writeCache");
+
+  FileHeader header {};
+  header.magic = FILE_MAGIC;
+  header.version = FILE_VERSION;
+  header.vertexSize = sizeof(Vertex);
+  header.meshCount = static_cast<uint32_t>(meshes.size());
+  header.source = key;
+
+  const std::string tempPath = cachePath + ".tmp";
+  {
+    std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+      std::cerr << "[WARNING]: failed to write mesh cache " << tempPath << "\n";
+      return;
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (const auto& [name, mesh] : meshes) {
+      MeshHeader meshHeader {};
+      meshHeader.nameSize = static_cast<uint32_t>(name.size());
+      meshHeader.indexType = static_cast<uint32_t>(mesh->getIndexType());
+      meshHeader.vertexCount = mesh->vertexCount();
+      meshHeader.indexSize = mesh->indexSize();
+      file.write(reinterpret_cast<const char*>(&meshHeader), sizeof(meshHeader));
+      file.write(name.data(), name.size());
+      file.write(reinterpret_cast<const char*>(mesh->data()), mesh->size());
+      file.write(static_cast<const char*>(mesh->indices()), mesh->indexSize());
+    }
+    if (!file) {
+      std::cerr << "[WARNING]: failed to write mesh cache " << tempPath << "\n";
+      return;
+    }
+  }
+
+  std::error_code error;
+  std::filesystem::rename(tempPath, cachePath, error);
+  if (error) {
+    std::cerr << "[WARNING]: failed to replace mesh cache " << cachePath << ": " << error.message() << "\n";
+    std::filesystem::remove(tempPath, error);
+  }
+}
+
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "mesh.h"
+#include "../util/thread_pool.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace mb {
+
+/**
+ * @brief a mesh of an imported file, named after the object or group it
+ *        was read from
+ *
+ */
+struct ImportedMesh {
+  std::string name;
+  std::shared_ptr<Mesh> mesh;
+};
+
+/**
+ * @brief imports Wavefront OBJ files as one mesh per object or group
+ *
+ * The text is parsed in chunks across the thread pool, as is turning the
+ * faces into vertices, merging duplicate vertices and optimizing the meshes.
+ * Polygons are triangulated as fans, materials are read with tinyobjloader.
+ * The built meshes are written to a binary cache next to the source,
+ * "<file>.mbmesh", keyed by the size, modification time and hash of the
+ * source, so loading it again skips the text entirely.
+ */
+class ObjImporter {
+public:
+  ObjImporter(ThreadPool& _threadPool);
+
+  ObjImporter (const ObjImporter&) = delete;
+  ObjImporter& operator= (const ObjImporter&) = delete;
+
+  std::vector<ImportedMesh> load(const std::string& filePath);
+
+private:
+  // identifies the source file a cache was built from
+  struct SourceKey {
+    uint64_t size;
+    int64_t modifiedTime;
+    uint64_t hash;
+  };
+
+  // header of the cache file, written in host byte order
+  struct FileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t vertexSize;
+    uint32_t meshCount;
+    SourceKey source;
+  };
+
+  // header of every mesh, followed by its name, vertices and indices
+  struct MeshHeader {
+    uint32_t nameSize;
+    uint32_t indexType;
+    uint64_t vertexCount;
+    uint64_t indexSize;
+  };
+
+  static constexpr uint32_t FILE_MAGIC = 0x534d424d; // "MBMS"
+  static constexpr uint32_t FILE_VERSION = 2;
+  // bytes of text parsed by one task
+  static constexpr size_t PARSE_CHUNK_SIZE = 4 * 1024 * 1024;
+  // triangles assembled by one task
+  static constexpr size_t CHUNK_TRIANGLES = 64 * 1024;
+  // bytes of the source hashed by one task
+  static constexpr size_t HASH_CHUNK_SIZE = 16 * 1024 * 1024;
+
+  ThreadPool& threadPool;
+
+  SourceKey makeKey(const std::string& filePath);
+  std::vector<ImportedMesh> parse(const std::string& filePath);
+  std::vector<ImportedMesh> readCache(const std::string& cachePath, const SourceKey& key);
+  void writeCache(const std::string& cachePath, const SourceKey& key, const std::vector<ImportedMesh>& meshes);
+};
+
+}
@@ -0,0 +1,154 @@
+#include "render_queue.h"
+
+#include "../util/profiler.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+namespace mb {
+
+/**
+ * @brief pack the sort key of a draw, fields wider than their bits wrap
+ *
+ * @param pass : pass the draw belongs to, passes record in increasing order
+ * @param pipeline : id of the pipeline
+ * @param material : id of the material, its render state and bindings
+ * @param mesh : id of the mesh
+ * @param depth : normalized depth, 0 first, invert it to sort back to front
+ * @return uint64_t : key draws are sorted by
+ */
+uint64_t RenderQueue::makeKey(const uint32_t pass, const uint32_t pipeline, const uint32_t material, const uint32_t mesh, const float depth) {
+  constexpr uint64_t DEPTH_MAX = (1ull << DEPTH_BITS) - 1;
+  const uint64_t quantizedDepth = static_cast<uint64_t>(std::clamp(depth, 0.f, 1.f) * DEPTH_MAX);
+
+  uint64_t key = pass & ((1ull << PASS_BITS) - 1);
+  key = (key << PIPELINE_BITS) | (pipeline & ((1ull << PIPELINE_BITS) - 1));
+  key = (key << MATERIAL_BITS) | (material & ((1ull << MATERIAL_BITS) - 1));
+  key = (key << MESH_BITS) | (mesh & ((1ull << MESH_BITS) - 1));
+  key = (key << DEPTH_BITS) | quantizedDepth;
+  return key;
+}
+
+/**
+ * @brief queue a draw for this frame
+ *
+ * @param key : sort key, see makeKey
+ * @param packet : the draw
+ */
+void RenderQueue::push(const uint64_t key, const DrawPacket& packet) {
+  entries.push_back({key, static_cast<uint32_t>(packets.size())});
+  packets.push_back(packet);
+}
+
+/**
+ * @brief LSD radix sort of the packets by key, one byte per pass, skipping
+ *        bytes every key shares
+ *
+ */
+void RenderQueue::sort() {
+  MB_PROFILE_ZONE("RenderQueue::sort");
+
+  const size_t count = entries.size();
+  if (count < 2) return;
+  scratch.resize(count);
+
+  // histograms of all 8 bytes in one pass over the keys
+  std::array<std::array<uint32_t, 256>, 8> histograms {};
+  for (const auto& entry : entries) {
+    for (uint32_t byte = 0; byte < 8; byte++) {
+      histograms[byte][(entry.key >> (byte * 8)) & 0xff]++;
+    }
+  }
+
+  for (uint32_t byte = 0; byte < 8; byte++) {
+    auto& histogram = histograms[byte];
+    // every key has the same value in this byte, the order is unchanged
+    if (histogram[(entries[0].key >> (byte * 8)) & 0xff] == count) continue;
+
+    uint32_t offset = 0;
+    for (auto& bucket : histogram) {
+      const uint32_t size = bucket;
+      bucket = offset;
+      offset += size;
+    }
+    for (const auto& entry : entries) {
+      scratch[histogram[(entry.key >> (byte * 8)) & 0xff]++] = entry;
+    }
+    entries.swap(scratch);
+  }
+}
+
+/**
+ * @brief drop every packet, keeping the memory for the next frame
+ *
+ */
+void RenderQueue::clear() {
+  packets.clear();
+  entries.clear();
+}
+
+/**
+ * @brief record a range of the sorted draws, binding only what changes
+ *        between neighbouring draws
+ *
+ * Nothing is assumed to be bound when the range starts, so ranges can be
+ * recorded into separate command buffers on separate threads.
+ *
+ * @param buffer : command buffer inside the pass
+ * @param first : first sorted draw to record
+ * @param count : number of draws to record
+ */
+void RenderQueue::record(VkCommandBuffer buffer, const uint32_t first, const uint32_t count) const {
+  VkPipeline boundPipeline = VK_NULL_HANDLE;
+  const RenderState* boundState = nullptr;
+  VkPipelineLayout boundLayout = VK_NULL_HANDLE;
+  VkDescriptorSet boundSet = VK_NULL_HANDLE;
+  uint32_t boundOffsets[2] = {};
+  VkBuffer boundVertexBuffer = VK_NULL_HANDLE;
+  VkBuffer boundIndexBuffer = VK_NULL_HANDLE;
+  VkIndexType boundIndexType = VK_INDEX_TYPE_UINT16;
+
+  for (uint32_t i = first; i < first + count; i++) {
+    const DrawPacket& packet = packets[entries[i].index];
+
+    if (packet.pipeline != boundPipeline) {
+      vkCmdBindPipeline(buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, packet.pipeline);
+      boundPipeline = packet.pipeline;
+      // state set before the bind only survives where both pipelines have it dynamic
+      boundState = nullptr;
+    }
+    // sets bound through an incompatible layout are disturbed
+    if (packet.layout != boundLayout) {
+      boundLayout = packet.layout;
+      boundSet = VK_NULL_HANDLE;
+    }
+    if (packet.state != nullptr && packet.state != boundState) {
+      packet.state->record(buffer);
+      boundState = packet.state;
+    }
+    if (packet.descriptorSet != boundSet || std::memcmp(packet.dynamicOffsets, boundOffsets, sizeof(boundOffsets)) != 0) {
+      vkCmdBindDescriptorSets(buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, packet.layout, 0, 1, &packet.descriptorSet, 2, packet.dynamicOffsets);
+      boundSet = packet.descriptorSet;
+      std::memcpy(boundOffsets, packet.dynamicOffsets, sizeof(boundOffsets));
+    }
+    if (packet.vertexBuffer != boundVertexBuffer) {
+      const VkDeviceSize offset = 0;
+      vkCmdBindVertexBuffers(buffer, 0, 1, &packet.vertexBuffer, &offset);
+      boundVertexBuffer = packet.vertexBuffer;
+    }
+
+    if (packet.indexBuffer == VK_NULL_HANDLE) {
+      vkCmdDraw(buffer, packet.count, 1, static_cast<uint32_t>(packet.vertexOffset), 0);
+      continue;
+    }
+    if (packet.indexBuffer != boundIndexBuffer || packet.indexType != boundIndexType) {
+      vkCmdBindIndexBuffer(buffer, packet.indexBuffer, 0, packet.indexType);
+      boundIndexBuffer = packet.indexBuffer;
+      boundIndexType = packet.indexType;
+    }
+    vkCmdDrawIndexed(buffer, packet.count, 1, packet.firstIndex, packet.vertexOffset, 0);
+  }
+}
+
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "../vulkan/pipeline_builder.h"
+
+#include <cstdint>
+#include <vector>
+
+#include <vulkan/vulkan_core.h>
+
+namespace mb {
+
+/**
+ * @brief everything needed to record one draw, resolved when it is pushed so
+ *        recording never looks up resources
+ *
+ */
+struct DrawPacket {
+  VkPipeline pipeline = VK_NULL_HANDLE;
+  const RenderState* state = nullptr;
+  VkPipelineLayout layout = VK_NULL_HANDLE;
+  VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+  // camera and object uniforms
+  uint32_t dynamicOffsets[2] = {};
+  VkBuffer vertexBuffer = VK_NULL_HANDLE;
+  // VK_NULL_HANDLE for a non indexed draw
+  VkBuffer indexBuffer = VK_NULL_HANDLE;
+  VkIndexType indexType = VK_INDEX_TYPE_UINT16;
+  // vertex count, or index count when indexed
+  uint32_t count = 0;
+  uint32_t firstIndex = 0;
+  int32_t vertexOffset = 0;
+};
+
+/**
+ * @brief draws pushed by any system in a frame, radix sorted by a 64 bit key
+ *        and recorded with redundant binds skipped
+ *
+ * The key orders draws by pass, then pipeline, material, mesh and depth, so
+ * draws sharing state end up next to each other.
+ */
+class RenderQueue {
+public:
+  // bits of each field of the key, from the most significant
+  static constexpr uint32_t PASS_BITS = 4;
+  static constexpr uint32_t PIPELINE_BITS = 12;
+  static constexpr uint32_t MATERIAL_BITS = 12;
+  static constexpr uint32_t MESH_BITS = 16;
+  static constexpr uint32_t DEPTH_BITS = 20;
+
+  static uint64_t makeKey(const uint32_t pass, const uint32_t pipeline, const uint32_t material, const uint32_t mesh, const float depth);
+
+  void push(const uint64_t key, const DrawPacket& packet);
+  void sort();
+  void clear();
+
+  uint32_t size() const {return static_cast<uint32_t>(packets.size());}
+  bool empty() const {return packets.empty();}
+
+  void record(VkCommandBuffer buffer, const uint32_t first, const uint32_t count) const;
+
+private:
+  // key of a packet with its position in packets
+  struct SortEntry {
+    uint64_t key;
+    uint32_t index;
+  };
+
+  std::vector<DrawPacket> packets;
+  // packets in sorted order once sort has run
+  std::vector<SortEntry> entries;
+  std::vector<SortEntry> scratch;
+};
+
+}
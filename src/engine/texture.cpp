@@ -8,7 +8,13 @@
 
 namespace mb {
 
-void Texture::createTextureImage(const std::string filePath) {
+/**
+ * @brief load an image file and queue its upload to a device local image
+ * 
+ * @param filePath : path to the image file
+ * @param uploads : queue the pixel copy is batched into
+ */
+void Texture::createTextureImage(const std::string filePath, UploadQueue& uploads) {
   int texWidth, texHeight, texChannels;
   stbi_uc* pixels = stbi_load(filePath.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
 
@@ -16,13 +22,37 @@ void Texture::createTextureImage(const std::string filePath) {
     throw std::runtime_error("[ERROR]: failed to load texture image at: " + filePath);
   }
 
-  const VkDeviceSize imageSize = texWidth * texHeight * 4;
-
-  image = std::make_unique<ImageBuffer>();
-  image->createImage(texWidth, texHeight, 1, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
-  image->mapMemory(pixels, imageSize);
+  createImage(pixels, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight), uploads);
 
   stbi_image_free(pixels);
 }
 
+/**
+ * @brief create a device local image and queue the upload of its pixels
+ * 
+ * @param pixels : tightly packed RGBA8 pixels, staged before this returns
+ * @param width : width of the image
+ * @param height : height of the image
+ * @param uploads : queue the pixel copy is batched into
+ */
+void Texture::createImage(const void* pixels, const uint32_t width, const uint32_t height, UploadQueue& uploads) {
+  const VkDeviceSize imageSize = static_cast<VkDeviceSize>(width) * height * 4;
+
+  image = std::make_unique<ImageBuffer>();
+  image->createImage(
+    width, 
+    height, 
+    1, 
+    VK_FORMAT_R8G8B8A8_SRGB, 
+    VK_IMAGE_TILING_OPTIMAL, 
+    VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+    VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE,
+    0
+  );
+
+  // the pixels are staged before enqueue returns, so they can be freed right away
+  const VkExtent3D extent = {width, height, 1};
+  uploadTicket = uploads.uploadImage(image->get(), pixels, imageSize, extent);
+}
+
 }
\ No newline at end of file
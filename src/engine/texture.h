@@ -1,25 +1,33 @@
 #pragma once
 
+#include <cstdint>
 #include <memory>
 #include <string>
 
 #include <vulkan/vulkan_core.h>
 
 #include "../vulkan/image_buffer.h"
+#include "../vulkan/upload_queue.h"
 
 namespace mb {
 
 class Texture {
 public:
-  Texture(const std::string filePath) {
-    createTextureImage(filePath);
+  Texture(const std::string filePath, UploadQueue& uploads) {
+    createTextureImage(filePath, uploads);
+  }
+  Texture(const void* pixels, const uint32_t width, const uint32_t height, UploadQueue& uploads) {
+    createImage(pixels, width, height, uploads);
   }
 
   std::unique_ptr<ImageBuffer> image;
+  // completes once the pixels are resident and the image is shader readable
+  UploadTicket uploadTicket;
    
 private:
 
-  void createTextureImage(const std::string filePath);
+  void createTextureImage(const std::string filePath, UploadQueue& uploads);
+  void createImage(const void* pixels, const uint32_t width, const uint32_t height, UploadQueue& uploads);
 };
 
 }
\ No newline at end of file
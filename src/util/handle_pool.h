@@ -0,0 +1,183 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace mb {
+
+/**
+ * @brief generational index into a HandlePool, a handle whose resource was
+ *        removed stays invalid even after its slot is reused
+ *
+ */
+template<typename T>
+struct Handle {
+  static constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+
+  uint32_t index = INVALID_INDEX;
+  uint32_t generation = 0;
+
+  bool isValid() const {return index != INVALID_INDEX;}
+  bool operator== (const Handle& other) const {return index == other.index && generation == other.generation;}
+  bool operator!= (const Handle& other) const {return !(*this == other);}
+};
+
+/**
+ * @brief owns resources in dense storage, addressed by generational handles
+ *
+ * Names are only meant to be resolved at load time with find, lookups by
+ * handle are two array indexes. Removing a resource moves the last one into
+ * its place so the storage stays packed for iteration.
+ */
+template<typename T>
+class HandlePool {
+public:
+  HandlePool() {}
+
+  HandlePool (const HandlePool&) = delete;
+  HandlePool& operator= (const HandlePool&) = delete;
+
+  /**
+   * @brief add a resource, names must be unique so handles resolved by
+   *        name keep pointing at the same resource
+   *
+   * @param value : resource to own
+   * @param name : optional name the handle can be found by
+   * @return Handle<T> : handle to the resource
+   */
+  Handle<T> insert(T value, const std::string& name = {}) {
+    if (!name.empty() && names.count(name) > 0) {
+      throw std::runtime_error("[ERROR]: a resource named " + name + " already exists");
+    }
+
+    uint32_t slot;
+    if (!freeSlots.empty()) {
+      slot = freeSlots.back();
+      freeSlots.pop_back();
+    }
+    else {
+      slot = static_cast<uint32_t>(slots.size());
+      slots.push_back({});
+    }
+
+    slots[slot].dense = static_cast<uint32_t>(values.size());
+    values.push_back(std::move(value));
+    denseSlots.push_back(slot);
+    denseNames.push_back(name);
+
+    Handle<T> handle {slot, slots[slot].generation};
+    if (!name.empty()) {
+      names[name] = handle;
+    }
+    return handle;
+  }
+
+  /**
+   * @brief destroy a resource, stale and invalid handles are ignored
+   *
+   */
+  void remove(const Handle<T> handle) {
+    if (!contains(handle)) return;
+
+    const uint32_t dense = slots[handle.index].dense;
+    const uint32_t last = static_cast<uint32_t>(values.size()) - 1;
+    if (!denseNames[dense].empty()) {
+      names.erase(denseNames[dense]);
+    }
+    if (dense != last) {
+      values[dense] = std::move(values[last]);
+      denseSlots[dense] = denseSlots[last];
+      denseNames[dense] = std::move(denseNames[last]);
+      slots[denseSlots[dense]].dense = dense;
+    }
+    values.pop_back();
+    denseSlots.pop_back();
+    denseNames.pop_back();
+
+    slots[handle.index].dense = INVALID_DENSE;
+    slots[handle.index].generation++;
+    freeSlots.push_back(handle.index);
+  }
+
+  bool contains(const Handle<T> handle) const {
+    return handle.index < slots.size() && slots[handle.index].generation == handle.generation
+      && slots[handle.index].dense != INVALID_DENSE;
+  }
+
+  /**
+   * @brief resolve a resource name, meant for load time
+   *
+   * @return Handle<T> : invalid if no resource has the name
+   */
+  Handle<T> find(const std::string& name) const {
+    auto it = names.find(name);
+    return it != names.end() ? it->second : Handle<T>{};
+  }
+
+  /**
+   * @brief checked lookup
+   *
+   * @return T* : nullptr if the handle is stale or invalid
+   */
+  T* get(const Handle<T> handle) {
+    return contains(handle) ? &values[slots[handle.index].dense] : nullptr;
+  }
+
+  // unchecked lookup for the hot path, the handle must be live
+  T& operator[] (const Handle<T> handle) {
+    assert(contains(handle));
+    return values[slots[handle.index].dense];
+  }
+  const T& operator[] (const Handle<T> handle) const {
+    assert(contains(handle));
+    return values[slots[handle.index].dense];
+  }
+
+  // iterate the resources in dense order
+  typename std::vector<T>::iterator begin() {return values.begin();}
+  typename std::vector<T>::iterator end() {return values.end();}
+  typename std::vector<T>::const_iterator begin() const {return values.begin();}
+  typename std::vector<T>::const_iterator end() const {return values.end();}
+
+  size_t size() const {return values.size();}
+  bool empty() const {return values.empty();}
+
+  /**
+   * @brief destroy every resource, invalidating all handles
+   *
+   */
+  void clear() {
+    for (uint32_t dense = 0; dense < denseSlots.size(); dense++) {
+      slots[denseSlots[dense]].dense = INVALID_DENSE;
+      slots[denseSlots[dense]].generation++;
+      freeSlots.push_back(denseSlots[dense]);
+    }
+    values.clear();
+    denseSlots.clear();
+    denseNames.clear();
+    names.clear();
+  }
+
+private:
+  static constexpr uint32_t INVALID_DENSE = UINT32_MAX;
+
+  // position of a live resource in dense storage
+  struct Slot {
+    uint32_t dense = INVALID_DENSE;
+    uint32_t generation = 0;
+  };
+
+  std::vector<T> values;
+  std::vector<uint32_t> denseSlots;
+  std::vector<std::string> denseNames;
+  std::vector<Slot> slots;
+  std::vector<uint32_t> freeSlots;
+  std::unordered_map<std::string, Handle<T>> names;
+};
+
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace mb {
+
+inline constexpr uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+
+/**
+ * @brief 64 bit FNV-1a hash, pass an earlier result as the seed to continue
+ *        hashing more bytes
+ * 
+ */
+inline uint64_t fnv1a(const void* data, const size_t size, uint64_t hash = FNV_OFFSET_BASIS) {
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+  for (size_t i = 0; i < size; i++) {
+    hash ^= bytes[i];
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+}
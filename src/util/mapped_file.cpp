@@ -0,0 +1,89 @@
+#include "mapped_file.h"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+  #ifndef NOMINMAX
+    #define NOMINMAX
+  #endif
+  #include <windows.h>
+#else
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+namespace mb {
+
+/**
+ * @brief map a file into memory
+ * 
+ * @param filePath : file to map, an empty file maps to a null view
+ */
+MappedFile::MappedFile(const std::string& filePath) {
+#ifdef _WIN32
+  HANDLE fileHandle = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (fileHandle == INVALID_HANDLE_VALUE) {
+    throw std::runtime_error("[ERROR]: failed to open file: " + filePath);
+  }
+  file = fileHandle;
+
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(fileHandle, &size)) {
+    CloseHandle(fileHandle);
+    throw std::runtime_error("[ERROR]: failed to read size of file: " + filePath);
+  }
+  fileSize = static_cast<size_t>(size.QuadPart);
+  if (fileSize == 0) {
+    return;
+  }
+
+  mapping = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (!mapping) {
+    CloseHandle(fileHandle);
+    throw std::runtime_error("[ERROR]: failed to map file: " + filePath);
+  }
+  view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  if (!view) {
+    CloseHandle(mapping);
+    CloseHandle(fileHandle);
+    throw std::runtime_error("[ERROR]: failed to map file: " + filePath);
+  }
+#else
+  file = open(filePath.c_str(), O_RDONLY);
+  if (file < 0) {
+    throw std::runtime_error("[ERROR]: failed to open file: " + filePath);
+  }
+
+  struct stat info;
+  if (fstat(file, &info) != 0) {
+    close(file);
+    throw std::runtime_error("[ERROR]: failed to read size of file: " + filePath);
+  }
+  fileSize = static_cast<size_t>(info.st_size);
+  if (fileSize == 0) {
+    return;
+  }
+
+  void* address = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, file, 0);
+  if (address == MAP_FAILED) {
+    close(file);
+    throw std::runtime_error("[ERROR]: failed to map file: " + filePath);
+  }
+  view = address;
+#endif
+}
+
+MappedFile::~MappedFile() {
+#ifdef _WIN32
+  if (view) UnmapViewOfFile(view);
+  if (mapping) CloseHandle(mapping);
+  if (file) CloseHandle(file);
+#else
+  if (view) munmap(const_cast<void*>(view), fileSize);
+  if (file >= 0) close(file);
+#endif
+}
+
+}
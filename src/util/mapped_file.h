@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace mb {
+
+/**
+ * @brief read only memory mapping of a whole file
+ * 
+ */
+class MappedFile {
+public:
+  MappedFile(const std::string& filePath);
+  ~MappedFile();
+
+  MappedFile (const MappedFile&) = delete;
+  MappedFile& operator= (const MappedFile&) = delete;
+
+  const void* data() const {return view;}
+  size_t size() const {return fileSize;}
+
+private:
+  const void* view = nullptr;
+  size_t fileSize = 0;
+
+#ifdef _WIN32
+  void* file = nullptr;
+  void* mapping = nullptr;
+#else
+  int file = -1;
+#endif
+};
+
+}
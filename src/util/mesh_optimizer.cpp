@@ -0,0 +1,197 @@
+#include "mesh_optimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace mb {
+
+namespace {
+
+// Tom Forsyth's linear-speed vertex cache optimisation, with his constants
+constexpr uint32_t CACHE_SIZE = 32;
+constexpr float CACHE_DECAY_POWER = 1.5f;
+constexpr float LAST_TRIANGLE_SCORE = 0.75f;
+constexpr float VALENCE_BOOST_SCALE = 2.0f;
+constexpr float VALENCE_BOOST_POWER = 0.5f;
+constexpr uint32_t INVALID_TRIANGLE = UINT32_MAX;
+
+/**
+ * @brief how much emitting a triangle using a vertex is worth, higher for
+ *        vertices recently used and for vertices with few triangles left
+ *
+ * @param cachePosition : position in the simulated cache, negative if not cached
+ * @param liveTriangles : triangles using the vertex that are not emitted yet
+ */
+float vertexScore(const int32_t cachePosition, const uint32_t liveTriangles) {
+  if (liveTriangles == 0) {
+    return -1.f;
+  }
+
+  float score = 0.f;
+  if (cachePosition >= 0) {
+    // the last triangle's vertices score the same, whichever order they went in
+    if (cachePosition < 3) {
+      score = LAST_TRIANGLE_SCORE;
+    }
+    else {
+      const float scale = 1.f / (CACHE_SIZE - 3);
+      score = std::pow(1.f - (cachePosition - 3) * scale, CACHE_DECAY_POWER);
+    }
+  }
+  // finish off vertices with few triangles left, so they leave the cache for good
+  score += VALENCE_BOOST_SCALE * std::pow(static_cast<float>(liveTriangles), -VALENCE_BOOST_POWER);
+  return score;
+}
+
+}
+
+/**
+ * @brief reorder the triangles of a triangle list so vertices are reused
+ *        while still in the post-transform cache
+ *
+ * Greedily emits the best scoring triangle around the vertices of a
+ * simulated LRU cache, falling back to the next unemitted triangle when
+ * none of the cached vertices has triangles left.
+ *
+ * @param indices : triangle list, reordered in place
+ * @param vertexCount : number of vertices the indices address
+ */
+void optimizeVertexCache(std::vector<uint32_t>& indices, const uint32_t vertexCount) {
+  if (indices.size() % 3 != 0) {
+    throw std::runtime_error("[ERROR]: triangle list index count is not a multiple of 3");
+  }
+  const uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+  if (triangleCount == 0) return;
+
+  // triangles of every vertex, the live ones first in each range
+  std::vector<uint32_t> liveTriangles(vertexCount, 0);
+  for (const uint32_t index : indices) {
+    liveTriangles[index]++;
+  }
+  std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+  for (uint32_t vertex = 0; vertex < vertexCount; vertex++) {
+    adjacencyOffsets[vertex + 1] = adjacencyOffsets[vertex] + liveTriangles[vertex];
+  }
+  std::vector<uint32_t> adjacency(triangleCount * 3);
+  std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+  for (uint32_t triangle = 0; triangle < triangleCount; triangle++) {
+    for (uint32_t corner = 0; corner < 3; corner++) {
+      adjacency[fill[indices[triangle * 3 + corner]]++] = triangle;
+    }
+  }
+
+  std::vector<int32_t> cachePositions(vertexCount, -1);
+  std::vector<float> vertexScores(vertexCount);
+  for (uint32_t vertex = 0; vertex < vertexCount; vertex++) {
+    vertexScores[vertex] = vertexScore(-1, liveTriangles[vertex]);
+  }
+
+  std::vector<float> triangleScores(triangleCount);
+  uint32_t best = 0;
+  for (uint32_t triangle = 0; triangle < triangleCount; triangle++) {
+    triangleScores[triangle] = vertexScores[indices[triangle * 3]] + vertexScores[indices[triangle * 3 + 1]] + vertexScores[indices[triangle * 3 + 2]];
+    if (triangleScores[triangle] > triangleScores[best]) {
+      best = triangle;
+    }
+  }
+
+  std::vector<bool> emitted(triangleCount, false);
+  std::vector<uint32_t> result;
+  result.reserve(indices.size());
+  std::vector<uint32_t> cache;
+  std::vector<uint32_t> nextCache;
+  cache.reserve(CACHE_SIZE + 3);
+  nextCache.reserve(CACHE_SIZE + 3);
+  uint32_t cursor = 0;
+
+  while (result.size() < triangleCount * 3) {
+    // dead end, continue with the next triangle in the original order
+    if (best == INVALID_TRIANGLE) {
+      while (emitted[cursor]) {
+        cursor++;
+      }
+      best = cursor;
+    }
+
+    emitted[best] = true;
+    nextCache.clear();
+    for (uint32_t corner = 0; corner < 3; corner++) {
+      const uint32_t vertex = indices[best * 3 + corner];
+      result.push_back(vertex);
+
+      // take the triangle out of the live range of the vertex
+      const uint32_t begin = adjacencyOffsets[vertex];
+      const uint32_t end = begin + liveTriangles[vertex];
+      const auto it = std::find(adjacency.begin() + begin, adjacency.begin() + end, best);
+      std::iter_swap(it, adjacency.begin() + end - 1);
+      liveTriangles[vertex]--;
+
+      if (std::find(nextCache.begin(), nextCache.end(), vertex) == nextCache.end()) {
+        nextCache.push_back(vertex);
+      }
+    }
+    for (const uint32_t vertex : cache) {
+      if (std::find(nextCache.begin(), nextCache.end(), vertex) == nextCache.end()) {
+        nextCache.push_back(vertex);
+      }
+    }
+
+    // rescore every vertex that moved in or fell out of the cache, along
+    // with the triangles still using it
+    for (uint32_t i = 0; i < nextCache.size(); i++) {
+      const uint32_t vertex = nextCache[i];
+      cachePositions[vertex] = i < CACHE_SIZE ? static_cast<int32_t>(i) : -1;
+      const float score = vertexScore(cachePositions[vertex], liveTriangles[vertex]);
+      const float delta = score - vertexScores[vertex];
+      vertexScores[vertex] = score;
+
+      const uint32_t begin = adjacencyOffsets[vertex];
+      for (uint32_t j = begin; j < begin + liveTriangles[vertex]; j++) {
+        triangleScores[adjacency[j]] += delta;
+      }
+    }
+
+    // the next triangle is the best one around the cached vertices
+    best = INVALID_TRIANGLE;
+    float bestScore = -1.f;
+    const uint32_t cachedCount = std::min(static_cast<uint32_t>(nextCache.size()), CACHE_SIZE);
+    for (uint32_t i = 0; i < cachedCount; i++) {
+      const uint32_t vertex = nextCache[i];
+      const uint32_t begin = adjacencyOffsets[vertex];
+      for (uint32_t j = begin; j < begin + liveTriangles[vertex]; j++) {
+        if (triangleScores[adjacency[j]] > bestScore) {
+          best = adjacency[j];
+          bestScore = triangleScores[best];
+        }
+      }
+    }
+
+    nextCache.resize(cachedCount);
+    cache.swap(nextCache);
+  }
+
+  indices.swap(result);
+}
+
+/**
+ * @brief number vertices in the order the triangles first use them
+ *
+ * @param indices : triangle list, rewritten to the new numbering
+ * @param vertexCount : number of vertices the indices address
+ * @param usedCount : set to the number of vertices any triangle uses
+ * @return std::vector<uint32_t> : new index of every vertex, UINT32_MAX if unused
+ */
+std::vector<uint32_t> optimizeVertexFetchRemap(std::vector<uint32_t>& indices, const uint32_t vertexCount, uint32_t& usedCount) {
+  std::vector<uint32_t> remap(vertexCount, UINT32_MAX);
+  usedCount = 0;
+  for (uint32_t& index : indices) {
+    if (remap[index] == UINT32_MAX) {
+      remap[index] = usedCount++;
+    }
+    index = remap[index];
+  }
+  return remap;
+}
+
+}
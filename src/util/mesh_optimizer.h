@@ -0,0 +1,84 @@
+#pragma once
+
+#include "hash.h"
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+namespace mb {
+
+/**
+ * @brief merge identical vertices of a triangle list, comparing their bytes
+ *
+ * @param vertices : one vertex per triangle corner, left with the unique
+ *                   vertices in order of first use
+ * @return std::vector<uint32_t> : index of every corner into vertices
+ */
+template<typename V>
+std::vector<uint32_t> deduplicateVertices(std::vector<V>& vertices) {
+  static_assert(std::is_trivially_copyable_v<V>, "vertices are compared by their bytes");
+  constexpr uint32_t EMPTY = UINT32_MAX;
+
+  // open addressing over the unique vertices, at most half full
+  size_t tableSize = 1;
+  while (tableSize < vertices.size() * 2) {
+    tableSize *= 2;
+  }
+  std::vector<uint32_t> table(tableSize, EMPTY);
+
+  std::vector<uint32_t> indices(vertices.size());
+  uint32_t uniqueCount = 0;
+  for (size_t i = 0; i < vertices.size(); i++) {
+    size_t slot = fnv1a(&vertices[i], sizeof(V)) & (tableSize - 1);
+    while (table[slot] != EMPTY && std::memcmp(&vertices[table[slot]], &vertices[i], sizeof(V)) != 0) {
+      slot = (slot + 1) & (tableSize - 1);
+    }
+    // unique vertices are compacted in place, never past the corner being read
+    if (table[slot] == EMPTY) {
+      table[slot] = uniqueCount;
+      vertices[uniqueCount++] = vertices[i];
+    }
+    indices[i] = table[slot];
+  }
+  vertices.resize(uniqueCount);
+  return indices;
+}
+
+void optimizeVertexCache(std::vector<uint32_t>& indices, const uint32_t vertexCount);
+std::vector<uint32_t> optimizeVertexFetchRemap(std::vector<uint32_t>& indices, const uint32_t vertexCount, uint32_t& usedCount);
+
+/**
+ * @brief reorder the vertices of an indexed mesh into the order the GPU
+ *        fetches them, dropping vertices no triangle uses
+ *
+ * @param vertices : vertices of the mesh, reordered in place
+ * @param indices : triangle list, rewritten to the new order
+ */
+template<typename V>
+void optimizeVertexFetch(std::vector<V>& vertices, std::vector<uint32_t>& indices) {
+  uint32_t usedCount = 0;
+  const std::vector<uint32_t> remap = optimizeVertexFetchRemap(indices, static_cast<uint32_t>(vertices.size()), usedCount);
+
+  std::vector<V> reordered(usedCount);
+  for (size_t vertex = 0; vertex < vertices.size(); vertex++) {
+    if (remap[vertex] != UINT32_MAX) {
+      reordered[remap[vertex]] = vertices[vertex];
+    }
+  }
+  vertices.swap(reordered);
+}
+
+/**
+ * @brief the full build step of an indexed mesh, triangles are ordered for
+ *        the post-transform cache and then vertices for fetch locality
+ *
+ */
+template<typename V>
+void optimizeMesh(std::vector<V>& vertices, std::vector<uint32_t>& indices) {
+  optimizeVertexCache(indices, static_cast<uint32_t>(vertices.size()));
+  optimizeVertexFetch(vertices, indices);
+}
+
+}
@@ -0,0 +1,105 @@
+#include "profiler.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+namespace mb {
+
+/**
+ * @brief create and register the ring buffer of the calling thread
+ * 
+ */
+std::shared_ptr<Profiler::ThreadRing> Profiler::registerThread() {
+  auto ring = std::make_shared<ThreadRing>();
+
+  std::lock_guard<std::mutex> lock(registryMutex);
+  ring->threadId = static_cast<uint32_t>(rings.size());
+  ring->threadName = ring->threadId == 0 ? "main" : "thread " + std::to_string(ring->threadId);
+  rings.push_back(ring);
+  return ring;
+}
+
+/**
+ * @brief name the calling thread in exported traces
+ * 
+ * @param name : name shown for the thread's track
+ */
+void Profiler::setThreadName(const std::string& name) {
+  ThreadRing& ring = threadRing();
+  std::lock_guard<std::mutex> lock(registryMutex);
+  ring.threadName = name;
+}
+
+namespace {
+
+  void writeEscaped(std::ofstream& file, const char* text) {
+    for (const char* c = text; *c != '\0'; c++) {
+      if (*c == '"' || *c == '\\') file << '\\';
+      file << *c;
+    }
+  }
+
+}
+
+/**
+ * @brief write the recorded zones of every thread as a Chrome trace event
+ *        file, viewable in about:tracing or Perfetto, a file that cannot be
+ *        opened is reported and skipped
+ * 
+ * @param filePath : file to write
+ */
+void Profiler::writeChromeTrace(const std::string& filePath) {
+  std::ofstream file(filePath);
+  if (!file.is_open()) {
+    std::cerr << "[WARNING]: failed to open cpu trace " << filePath << "\n";
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(registryMutex);
+
+  // microseconds with nanosecond digits, the default precision loses
+  // resolution once timestamps pass a second
+  file << std::fixed << std::setprecision(3);
+  file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+  bool first = true;
+  for (const auto& ring : rings) {
+    if (!first) file << ",\n";
+    first = false;
+    file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << ring->threadId
+         << ",\"args\":{\"name\":\"";
+    writeEscaped(file, ring->threadName.c_str());
+    file << "\"}}";
+
+    // copy the published events, then drop the ones the thread started to
+    // overwrite during the copy, as any of them may be torn
+    const uint64_t end = ring->writeIndex.load(std::memory_order_acquire);
+    const uint64_t begin = end > RING_SIZE ? end - RING_SIZE : 0;
+    std::vector<ProfileEvent> events;
+    events.reserve(end - begin);
+    for (uint64_t i = begin; i < end; i++) {
+      const EventSlot& slot = ring->events[i % RING_SIZE];
+      events.push_back({
+        slot.name.load(std::memory_order_relaxed), 
+        slot.startNs.load(std::memory_order_relaxed), 
+        slot.endNs.load(std::memory_order_relaxed)
+      });
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const uint64_t writing = ring->writeIndex.load(std::memory_order_relaxed);
+    const uint64_t firstIntact = writing >= RING_SIZE ? writing - RING_SIZE + 1 : 0;
+
+    for (uint64_t i = std::max(begin, firstIntact); i < end; i++) {
+      const ProfileEvent& event = events[i - begin];
+      file << ",\n{\"name\":\"";
+      writeEscaped(file, event.name);
+      file << "\",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":1,\"tid\":" << ring->threadId
+           << ",\"ts\":" << event.startNs / 1000.0
+           << ",\"dur\":" << (event.endNs - event.startNs) / 1000.0 << "}";
+    }
+  }
+  file << "\n]}\n";
+}
+
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace mb {
+
+/**
+ * @brief a completed CPU zone, names must be string literals
+ * 
+ */
+struct ProfileEvent {
+  const char* name;
+  uint64_t startNs;
+  uint64_t endNs;
+};
+
+/**
+ * @brief low overhead CPU zone profiler, every thread records into its own
+ *        ring buffer without locking and the rings are merged into a Chrome
+ *        about:tracing / Perfetto JSON file on demand
+ */
+class Profiler {
+public:
+  // events kept per thread before the oldest are overwritten
+  static constexpr size_t RING_SIZE = 1 << 16;
+
+  static void setEnabled(const bool _enabled) {enabled.store(_enabled, std::memory_order_relaxed);}
+  static bool isEnabled() {return enabled.load(std::memory_order_relaxed);}
+
+  static void setThreadName(const std::string& name);
+  static void writeChromeTrace(const std::string& filePath);
+
+  /**
+   * @brief nanoseconds since the profiler was first used
+   * 
+   */
+  static uint64_t now() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - epoch).count());
+  }
+
+  /**
+   * @brief append a zone to the calling thread's ring buffer
+   * 
+   */
+  static void record(const char* name, const uint64_t startNs, const uint64_t endNs) {
+    ThreadRing& ring = threadRing();
+    const uint64_t index = ring.writeIndex.load(std::memory_order_relaxed);
+    // a trace writer that sees any of the stores below also sees index
+    // published, so it knows the slot is being overwritten
+    std::atomic_thread_fence(std::memory_order_release);
+    EventSlot& slot = ring.events[index % RING_SIZE];
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.startNs.store(startNs, std::memory_order_relaxed);
+    slot.endNs.store(endNs, std::memory_order_relaxed);
+    ring.writeIndex.store(index + 1, std::memory_order_release);
+  }
+
+private:
+  // atomic so a trace can be read while the thread overwrites the slot
+  struct EventSlot {
+    std::atomic<const char*> name = nullptr;
+    std::atomic<uint64_t> startNs = 0;
+    std::atomic<uint64_t> endNs = 0;
+  };
+
+  struct ThreadRing {
+    std::array<EventSlot, RING_SIZE> events;
+    std::atomic<uint64_t> writeIndex = 0;
+    uint32_t threadId = 0;
+    std::string threadName;
+  };
+
+  inline static std::atomic<bool> enabled = true;
+  inline static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+  // every ring ever registered, only locked when a thread records for the
+  // first time or when a trace is written
+  inline static std::mutex registryMutex;
+  inline static std::vector<std::shared_ptr<ThreadRing>> rings;
+
+  static ThreadRing& threadRing() {
+    thread_local std::shared_ptr<ThreadRing> ring = registerThread();
+    return *ring;
+  }
+
+  static std::shared_ptr<ThreadRing> registerThread();
+};
+
+/**
+ * @brief records the time between its construction and destruction
+ * 
+ */
+class ProfileZone {
+public:
+  ProfileZone(const char* _name) : name(_name), active(Profiler::isEnabled()) {
+    if (active) start = Profiler::now();
+  }
+
+  ~ProfileZone() {
+    if (active) Profiler::record(name, start, Profiler::now());
+  }
+
+  ProfileZone (const ProfileZone&) = delete;
+  ProfileZone& operator= (const ProfileZone&) = delete;
+
+private:
+  const char* name;
+  bool active;
+  uint64_t start = 0;
+};
+
+}
+
+#define MB_PROFILE_CONCAT_INNER(a, b) a##b
+#define MB_PROFILE_CONCAT(a, b) MB_PROFILE_CONCAT_INNER(a, b)
+#define MB_PROFILE_ZONE(name) ::mb::ProfileZone MB_PROFILE_CONCAT(profileZone, __LINE__)(name)
@@ -0,0 +1,111 @@
+#include "range_allocator.h"
+
+#include <stdexcept>
+
+namespace mb {
+
+/**
+ * @brief create an allocator with the whole range free
+ * 
+ * @param _capacity : end of the range
+ */
+RangeAllocator::RangeAllocator(const uint64_t _capacity) : capacity(_capacity) {
+  reset();
+}
+
+/**
+ * @brief take the smallest free range the aligned size fits in
+ * 
+ * @param size : size of the range, must not be 0
+ * @param alignment : the offset is a multiple of it
+ * @return std::optional<uint64_t> : offset of the range, empty if no free range fits
+ */
+std::optional<uint64_t> RangeAllocator::allocate(const uint64_t size, const uint64_t alignment) {
+  if (size == 0 || alignment == 0) {
+    throw std::runtime_error("[ERROR]: invalid range allocation");
+  }
+
+  // ranges are visited from the smallest that could hold the size, the
+  // first one that still fits once aligned is the best fit
+  for (auto it = freeBySize.lower_bound(size); it != freeBySize.end(); ++it) {
+    const uint64_t rangeOffset = it->second;
+    const uint64_t rangeSize = it->first;
+    const uint64_t offset = (rangeOffset + alignment - 1) / alignment * alignment;
+    if (offset + size > rangeOffset + rangeSize) continue;
+
+    eraseFree(freeByOffset.find(rangeOffset));
+    if (offset > rangeOffset) {
+      insertFree(rangeOffset, offset - rangeOffset);
+    }
+    if (offset + size < rangeOffset + rangeSize) {
+      insertFree(offset + size, rangeOffset + rangeSize - offset - size);
+    }
+    freeSize -= size;
+    return offset;
+  }
+  return std::nullopt;
+}
+
+/**
+ * @brief return a range, merging it with the free ranges around it
+ * 
+ * @param offset : offset returned by allocate
+ * @param size : size passed to allocate
+ */
+void RangeAllocator::free(const uint64_t offset, const uint64_t size) {
+  if (size == 0) return;
+  freeSize += size;
+
+  uint64_t begin = offset;
+  uint64_t end = offset + size;
+  auto next = freeByOffset.lower_bound(offset);
+  if (next != freeByOffset.end() && next->first == end) {
+    end += next->second;
+    eraseFree(next);
+  }
+  auto previous = freeByOffset.lower_bound(offset);
+  if (previous != freeByOffset.begin()) {
+    --previous;
+    if (previous->first + previous->second == begin) {
+      begin = previous->first;
+      eraseFree(previous);
+    }
+  }
+  insertFree(begin, end - begin);
+}
+
+/**
+ * @brief free every range
+ * 
+ */
+void RangeAllocator::reset() {
+  freeByOffset.clear();
+  freeBySize.clear();
+  freeSize = 0;
+  if (capacity > 0) {
+    insertFree(0, capacity);
+    freeSize = capacity;
+  }
+}
+
+uint64_t RangeAllocator::getLargestFreeRange() const {
+  return freeBySize.empty() ? 0 : freeBySize.rbegin()->first;
+}
+
+void RangeAllocator::insertFree(const uint64_t offset, const uint64_t size) {
+  freeByOffset.emplace(offset, size);
+  freeBySize.emplace(size, offset);
+}
+
+void RangeAllocator::eraseFree(std::map<uint64_t, uint64_t>::iterator it) {
+  auto [first, last] = freeBySize.equal_range(it->second);
+  for (auto sizeIt = first; sizeIt != last; ++sizeIt) {
+    if (sizeIt->second == it->first) {
+      freeBySize.erase(sizeIt);
+      break;
+    }
+  }
+  freeByOffset.erase(it);
+}
+
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <optional>
+
+namespace mb {
+
+/**
+ * @brief best fit allocator of ranges within [0, capacity), freed ranges
+ *        are merged with their free neighbours
+ * 
+ * Only offsets are handed out, the memory they address is owned elsewhere.
+ * Alignments do not have to be powers of two, so ranges can be aligned to
+ * the size of a vertex.
+ */
+class RangeAllocator {
+public:
+  RangeAllocator(const uint64_t _capacity = 0);
+
+  std::optional<uint64_t> allocate(const uint64_t size, const uint64_t alignment = 1);
+  void free(const uint64_t offset, const uint64_t size);
+  void reset();
+
+  uint64_t getCapacity() const {return capacity;}
+  uint64_t getFreeSize() const {return freeSize;}
+  uint64_t getLargestFreeRange() const;
+
+private:
+  uint64_t capacity;
+  uint64_t freeSize = 0;
+  // free ranges by offset and by size, always holding the same ranges
+  std::map<uint64_t, uint64_t> freeByOffset;
+  std::multimap<uint64_t, uint64_t> freeBySize;
+
+  void insertFree(const uint64_t offset, const uint64_t size);
+  void eraseFree(std::map<uint64_t, uint64_t>::iterator it);
+};
+
+}
@@ -0,0 +1,55 @@
+#include "thread_pool.h"
+#include "profiler.h"
+
+#include <string>
+
+namespace mb {
+
+/**
+ * @brief start the worker threads
+ * 
+ * @param threadCount : number of workers, at least one is started
+ * @param _name : name the workers are shown with in profiles
+ */
+ThreadPool::ThreadPool(const uint32_t threadCount, const std::string& _name) : name(_name) {
+  const uint32_t count = threadCount > 0 ? threadCount : 1;
+  workers.reserve(count);
+  for (uint32_t i = 0; i < count; i++) {
+    workers.emplace_back(&ThreadPool::workerLoop, this, i);
+  }
+}
+
+/**
+ * @brief finish every queued task and join the workers
+ * 
+ */
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  taskAvailable.notify_all();
+  for (auto& worker : workers) {
+    worker.join();
+  }
+}
+
+void ThreadPool::workerLoop(const uint32_t index) {
+  Profiler::setThreadName(name + " " + std::to_string(index));
+
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      taskAvailable.wait(lock, [this]() {return stopping || !tasks.empty();});
+      if (tasks.empty()) {
+        return;
+      }
+      task = std::move(tasks.front());
+      tasks.pop_front();
+    }
+    task();
+  }
+}
+
+}
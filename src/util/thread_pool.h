@@ -0,0 +1,67 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace mb {
+
+/**
+ * @brief fixed set of worker threads running tasks in submission order
+ * 
+ */
+class ThreadPool {
+public:
+  ThreadPool(const uint32_t threadCount = defaultThreadCount(), const std::string& _name = "worker");
+  ~ThreadPool();
+
+  ThreadPool (const ThreadPool&) = delete;
+  ThreadPool& operator= (const ThreadPool&) = delete;
+
+  /**
+   * @brief queue a task for the workers
+   * 
+   * @param function : task to run, exceptions it throws are stored in the future
+   * @return std::future : holds the result of the task once it has run
+   */
+  template<typename F>
+  auto submit(F&& function) -> std::future<std::invoke_result_t<std::decay_t<F>>> {
+    using Result = std::invoke_result_t<std::decay_t<F>>;
+    auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(function));
+    std::future<Result> result = task->get_future();
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      tasks.emplace_back([task]() {(*task)();});
+    }
+    taskAvailable.notify_one();
+    return result;
+  }
+
+  uint32_t getThreadCount() const {return static_cast<uint32_t>(workers.size());}
+
+  // one worker per core, leaving one for the main thread
+  static uint32_t defaultThreadCount() {
+    const uint32_t cores = std::thread::hardware_concurrency();
+    return cores > 1 ? cores - 1 : 1;
+  }
+
+private:
+  std::string name;
+  std::vector<std::thread> workers;
+  std::deque<std::function<void()>> tasks;
+  std::mutex mutex;
+  std::condition_variable taskAvailable;
+  bool stopping = false;
+
+  void workerLoop(const uint32_t index);
+};
+
+}
@@ -16,12 +16,28 @@ namespace mb {
 struct QueueFamilyIndices {
   std::optional<uint32_t> graphicsFamily;
   std::optional<uint32_t> presentFamily;
+  // dedicated transfer family, or the graphics family when there is none
+  std::optional<uint32_t> transferFamily;
 
   bool isComplete() {
     return graphicsFamily.has_value() && presentFamily.has_value();
   }
 };
 
+/**
+ * @brief groups of fixed function state the device can set while recording,
+ *        through core 1.3 or the VK_EXT_extended_dynamic_state extensions
+ * 
+ */
+struct ExtendedDynamicState {
+  // cull mode, front face, topology and the depth test, write and compare op
+  bool state1 = false;
+  // primitive restart and depth bias enable
+  bool state2 = false;
+  // color blend enable, equation and write mask, only through the extension
+  bool blend = false;
+};
+
 struct Vertex {
   glm::vec3 pos;
   glm::vec3 normal;
@@ -57,10 +73,87 @@ struct Vertex {
   }
 };
 
+/**
+ * @brief layout of the vertices of a mesh
+ * 
+ */
+enum class VertexFormat : uint32_t {
+  Full, // Vertex, 36 bytes
+  Packed, // PackedVertex, 16 bytes
+};
+
+/**
+ * @brief maps the normalized positions of a PackedVertex back to object
+ *        space, position = offset + scale * packed position
+ * 
+ */
+struct PositionQuantization {
+  glm::vec3 offset {0.f};
+  glm::vec3 scale {1.f};
+};
+
+/**
+ * @brief quantized vertex, 16 bytes against the 36 of Vertex
+ * 
+ * Positions are 16 bit normalized within the bounds of the mesh, see
+ * PositionQuantization. Normals are octahedral encoded into two 16 bit
+ * signed normalized values and colors are 8 bit normalized.
+ */
+struct PackedVertex {
+  // w is unused
+  uint16_t pos[4];
+  int16_t normal[2];
+  uint8_t color[4];
+
+  static std::vector<VkVertexInputBindingDescription> getBindingDescriptions() {
+    std::vector<VkVertexInputBindingDescription> bindingDescription (1);
+    bindingDescription[0].binding = 0;
+    bindingDescription[0].stride = sizeof(PackedVertex);
+    bindingDescription[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+    return bindingDescription;
+  }
+
+  static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions() {
+    std::vector<VkVertexInputAttributeDescription> attributeDescriptions (3);
+    attributeDescriptions[0].binding = 0;
+    attributeDescriptions[0].location = 0;
+    attributeDescriptions[0].format = VK_FORMAT_R16G16B16A16_UNORM;
+    attributeDescriptions[0].offset = offsetof(PackedVertex, pos);
+
+    attributeDescriptions[1].binding = 0;
+    attributeDescriptions[1].location = 1;
+    attributeDescriptions[1].format = VK_FORMAT_R16G16_SNORM;
+    attributeDescriptions[1].offset = offsetof(PackedVertex, normal);
+
+    attributeDescriptions[2].binding = 0;
+    attributeDescriptions[2].location = 2;
+    attributeDescriptions[2].format = VK_FORMAT_R8G8B8A8_UNORM;
+    attributeDescriptions[2].offset = offsetof(PackedVertex, color);
+
+    return attributeDescriptions;
+  }
+};
+
+/**
+ * @brief camera matrices, written once per frame
+ * 
+ */
 struct UniformBufferObject {
-  glm::mat4 model;
   glm::mat4 view;
   glm::mat4 proj;
+  glm::mat4 viewProj;
+};
+
+/**
+ * @brief constants of a single draw
+ * 
+ */
+struct ObjectUniforms {
+  glm::mat4 model;
+  // dequantization of packed positions, see PositionQuantization, w is unused
+  glm::vec4 positionOffset {0.f};
+  glm::vec4 positionScale {1.f};
 };
 
 }
\ No newline at end of file
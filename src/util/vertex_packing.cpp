@@ -0,0 +1,83 @@
+#include "vertex_packing.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace mb {
+
+namespace {
+
+uint16_t quantizeUnorm16(const float value) {
+  return static_cast<uint16_t>(std::lround(std::clamp(value, 0.f, 1.f) * 65535.f));
+}
+
+int16_t quantizeSnorm16(const float value) {
+  return static_cast<int16_t>(std::lround(std::clamp(value, -1.f, 1.f) * 32767.f));
+}
+
+uint8_t quantizeUnorm8(const float value) {
+  return static_cast<uint8_t>(std::lround(std::clamp(value, 0.f, 1.f) * 255.f));
+}
+
+}
+
+/**
+ * @brief quantization spreading the 16 bit positions over a bounding box,
+ *        axes where the box is flat quantize to 0
+ *
+ * @param min : smallest corner of the positions
+ * @param max : largest corner of the positions
+ */
+PositionQuantization quantizationFromBounds(const glm::vec3& min, const glm::vec3& max) {
+  PositionQuantization quantization {};
+  quantization.offset = min;
+  quantization.scale = glm::max(max - min, glm::vec3(0.f));
+  return quantization;
+}
+
+/**
+ * @brief map a unit vector onto the octahedron unfolded into [-1, 1]^2,
+ *        the lower hemisphere folded over the diagonals
+ *
+ * @param normal : unit vector, a zero vector encodes as +z
+ * @return glm::vec2 : coordinates on the unfolded octahedron
+ */
+glm::vec2 octahedralEncode(const glm::vec3& normal) {
+  const float length = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+  if (length == 0.f) {
+    return glm::vec2(0.f);
+  }
+  glm::vec2 encoded = glm::vec2(normal.x, normal.y) / length;
+  if (normal.z < 0.f) {
+    const glm::vec2 folded = glm::vec2(1.f) - glm::abs(glm::vec2(encoded.y, encoded.x));
+    encoded.x = encoded.x >= 0.f ? folded.x : -folded.x;
+    encoded.y = encoded.y >= 0.f ? folded.y : -folded.y;
+  }
+  return encoded;
+}
+
+/**
+ * @brief quantize the attributes of a vertex
+ *
+ * @param pos : object space position, within the bounds of the quantization
+ * @param normal : unit normal
+ * @param color : linear color in [0, 1]
+ * @param quantization : position quantization of the mesh
+ */
+PackedVertex packVertex(const glm::vec3& pos, const glm::vec3& normal, const glm::vec3& color, const PositionQuantization& quantization) {
+  PackedVertex vertex {};
+  for (int axis = 0; axis < 3; axis++) {
+    const float scale = quantization.scale[axis];
+    vertex.pos[axis] = scale > 0.f ? quantizeUnorm16((pos[axis] - quantization.offset[axis]) / scale) : 0;
+  }
+  const glm::vec2 encoded = octahedralEncode(normal);
+  vertex.normal[0] = quantizeSnorm16(encoded.x);
+  vertex.normal[1] = quantizeSnorm16(encoded.y);
+  for (int channel = 0; channel < 3; channel++) {
+    vertex.color[channel] = quantizeUnorm8(color[channel]);
+  }
+  vertex.color[3] = 255;
+  return vertex;
+}
+
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include "types.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+
+namespace mb {
+
+PositionQuantization quantizationFromBounds(const glm::vec3& min, const glm::vec3& max);
+glm::vec2 octahedralEncode(const glm::vec3& normal);
+PackedVertex packVertex(const glm::vec3& pos, const glm::vec3& normal, const glm::vec3& color, const PositionQuantization& quantization);
+
+}
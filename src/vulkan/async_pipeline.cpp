@@ -0,0 +1,58 @@
+#include "async_pipeline.h"
+#include "vk.h"
+
+#include "../util/profiler.h"
+
+#include <chrono>
+#include <utility>
+
+namespace mb {
+
+/**
+ * @brief queue the build of a pipeline
+ * 
+ * @param threadPool : pool the pipeline is compiled on
+ * @param description : state of the pipeline
+ * @param cache : pipeline cache to compile through, or VK_NULL_HANDLE
+ */
+AsyncPipeline::AsyncPipeline(ThreadPool& threadPool, PipelineDescription description, VkPipelineCache cache) {
+  compile = threadPool.submit([this, description = std::move(description), cache]() {
+    MB_PROFILE_ZONE("compile-pipeline");
+    pipeline.store(description.build(cache), std::memory_order_release);
+  });
+}
+
+/**
+ * @brief wait for the build and destroy the pipeline, it must no longer be
+ *        used by the GPU
+ */
+AsyncPipeline::~AsyncPipeline() {
+  if (compile.valid()) {
+    compile.wait();
+  }
+  vkDestroyPipeline(vk::device, pipeline.load(std::memory_order_acquire), nullptr);
+}
+
+/**
+ * @brief checks if the build has finished without blocking, rethrowing a
+ *        failed build on the calling thread
+ * 
+ */
+bool AsyncPipeline::isReady() {
+  if (compile.valid() && compile.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+    compile.get();
+  }
+  return get() != VK_NULL_HANDLE;
+}
+
+/**
+ * @brief block until the build has finished, rethrowing a failed build
+ * 
+ */
+void AsyncPipeline::wait() {
+  if (compile.valid()) {
+    compile.get();
+  }
+}
+
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "pipeline_builder.h"
+#include "../util/thread_pool.h"
+
+#include <atomic>
+#include <future>
+
+#include <vulkan/vulkan_core.h>
+
+namespace mb {
+
+/**
+ * @brief graphics pipeline compiled on a thread pool, get returns
+ *        VK_NULL_HANDLE until the build has finished
+ * 
+ */
+class AsyncPipeline {
+public:
+  AsyncPipeline(ThreadPool& threadPool, PipelineDescription description, VkPipelineCache cache = VK_NULL_HANDLE);
+  ~AsyncPipeline();
+
+  AsyncPipeline (const AsyncPipeline&) = delete;
+  AsyncPipeline& operator= (const AsyncPipeline&) = delete;
+
+  VkPipeline get() const {return pipeline.load(std::memory_order_acquire);}
+  bool isReady();
+  void wait();
+
+private:
+  std::atomic<VkPipeline> pipeline = VK_NULL_HANDLE;
+  std::future<void> compile;
+};
+
+}
@@ -17,7 +17,7 @@ public:
    * @brief maps vertex memory to the GPU
    * 
    */
-  void copyMemoryToAllocation(void* data, VkDeviceSize bufferSize) {
+  void copyMemoryToAllocation(const void* data, VkDeviceSize bufferSize) {
     if (vmaCopyMemoryToAllocation(vk::allocator, data, allocation, 0, bufferSize) != VK_SUCCESS) {
       throw std::runtime_error("[ERROR]: failed to copy vertex to GPU");
     }
@@ -26,10 +26,20 @@ public:
   void clear() {
       if (buffer) {
       vmaDestroyBuffer(vk::allocator, buffer, allocation);
+      buffer = VK_NULL_HANDLE;
+      mapped = nullptr;
     }
   }
 
 
+  /**
+   * @brief flush host writes to a mapped region, a no-op on coherent memory
+   * 
+   */
+  void flush(VkDeviceSize offset, VkDeviceSize size) {
+    vmaFlushAllocation(vk::allocator, allocation, offset, size);
+  }
+
   /**
    * @brief Create a Vertex Buffer object
    * 
@@ -44,12 +54,16 @@ public:
     allocInfo.usage = memUsage;
     allocInfo.flags = memFlags;
 
-    if (vmaCreateBuffer(vk::allocator, &bufferInfo, &allocInfo, &buffer, &allocation, nullptr) != VK_SUCCESS) {
+    VmaAllocationInfo allocationInfo {};
+    if (vmaCreateBuffer(vk::allocator, &bufferInfo, &allocInfo, &buffer, &allocation, &allocationInfo) != VK_SUCCESS) {
       throw std::runtime_error("[ERROR]: Failed to create buffer");
     }
+    // only set for persistently mapped allocations
+    mapped = allocationInfo.pMappedData;
   }
 
-  VkBuffer buffer;
+  VkBuffer buffer = VK_NULL_HANDLE;
+  void* mapped = nullptr;
 private:
   VmaAllocation allocation;
 };
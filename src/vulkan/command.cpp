@@ -5,6 +5,23 @@
 
 
 namespace mb {
+
+  /**
+   * @brief create a command pool and buffer for the graphics queue
+   * 
+   */
+  Command::Command() {
+    init(vk::queueIndices.graphicsFamily.value());
+  }
+
+  /**
+   * @brief create a command pool and buffer for a queue family
+   * 
+   * @param queueFamily : family of the queue the buffer is submitted to
+   */
+  Command::Command(const uint32_t queueFamily) {
+    init(queueFamily);
+  }
   
   Command::~Command() {
     vkDestroyCommandPool(vk::device, pool, nullptr);
@@ -14,8 +31,8 @@ namespace mb {
    * @brief create a command pool and allocate a main command buffer from it
    * 
    */
-  void Command::init() {
-    createCommandPool();
+  void Command::init(const uint32_t queueFamily) {
+    createCommandPool(queueFamily);
     allocateCommandBuffer();
   }
 
@@ -23,11 +40,11 @@ namespace mb {
    * @brief create a command pool from which to allocate commands from
    * 
    */
-  void Command::createCommandPool() {
+  void Command::createCommandPool(const uint32_t queueFamily) {
     VkCommandPoolCreateInfo commandPoolInfo {};
     commandPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
     commandPoolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-    commandPoolInfo.queueFamilyIndex = vk::queueIndices.graphicsFamily.value();
+    commandPoolInfo.queueFamilyIndex = queueFamily;
 
     if (vkCreateCommandPool(vk::device, &commandPoolInfo, nullptr, &pool) != VK_SUCCESS) {
       throw std::runtime_error("[ERROR]: Failed to create command pool");
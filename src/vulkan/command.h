@@ -1,20 +1,23 @@
 #pragma once
 
+#include <cstdint>
+
 #include <vulkan/vulkan_core.h>
 
 namespace mb {
 
 class Command {
 public:
-  Command() {init();}
+  Command();
+  explicit Command(const uint32_t queueFamily);
   ~Command();
 
   VkCommandPool pool;
   VkCommandBuffer buffer;
 private:
-  void init();
+  void init(const uint32_t queueFamily);
 
-  void createCommandPool();
+  void createCommandPool(const uint32_t queueFamily);
   void allocateCommandBuffer();
 };
 
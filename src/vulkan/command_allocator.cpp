@@ -0,0 +1,75 @@
+#include "command_allocator.h"
+#include "vk.h"
+
+#include <stdexcept>
+
+namespace mb {
+
+/**
+ * @brief create a transient pool for the graphics queue
+ * 
+ */
+CommandAllocator::CommandAllocator() : CommandAllocator(vk::queueIndices.graphicsFamily.value()) {}
+
+/**
+ * @brief create a transient pool for a queue family
+ * 
+ * @param queueFamily : family of the queue the buffers are submitted to
+ */
+CommandAllocator::CommandAllocator(const uint32_t queueFamily) {
+  VkCommandPoolCreateInfo poolInfo {};
+  poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  // buffers are never reset on their own, only with the pool
+  poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+  poolInfo.queueFamilyIndex = queueFamily;
+
+  if (vkCreateCommandPool(vk::device, &poolInfo, nullptr, &pool) != VK_SUCCESS) {
+    throw std::runtime_error("[ERROR]: Failed to create command pool");
+  }
+}
+
+CommandAllocator::~CommandAllocator() {
+  vkDestroyCommandPool(vk::device, pool, nullptr);
+}
+
+/**
+ * @brief hand out a command buffer in the initial state, reusing one from
+ *        an earlier frame when there is one
+ * 
+ * @param level : primary or secondary buffer
+ * @return VkCommandBuffer : buffer valid until the next reset
+ */
+VkCommandBuffer CommandAllocator::allocate(const VkCommandBufferLevel level) {
+  FreeList& list = level == VK_COMMAND_BUFFER_LEVEL_PRIMARY ? primaries : secondaries;
+  if (list.used < list.buffers.size()) {
+    return list.buffers[list.used++];
+  }
+
+  VkCommandBufferAllocateInfo bufferInfo {};
+  bufferInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  bufferInfo.commandPool = pool;
+  bufferInfo.level = level;
+  bufferInfo.commandBufferCount = 1;
+
+  VkCommandBuffer buffer;
+  if (vkAllocateCommandBuffers(vk::device, &bufferInfo, &buffer) != VK_SUCCESS) {
+    throw std::runtime_error("[ERROR]: Failed to allocate command buffer");
+  }
+  list.buffers.push_back(buffer);
+  list.used++;
+  return buffer;
+}
+
+/**
+ * @brief reset every buffer of the pool at once and return them to the
+ *        free list, the GPU must have finished executing them
+ * 
+ */
+void CommandAllocator::reset() {
+  // keep the pool's memory, the next frame records about as much
+  vkResetCommandPool(vk::device, pool, 0);
+  primaries.used = 0;
+  secondaries.used = 0;
+}
+
+}
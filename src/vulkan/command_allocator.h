@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <vulkan/vulkan_core.h>
+
+namespace mb {
+
+/**
+ * @brief transient command pool of one frame in flight, reset as a whole
+ *        once the frame has completed rather than buffer by buffer
+ * 
+ * Buffers handed out are valid until the next reset, which returns them to
+ * the free list to be handed out again. Like the pool it wraps, it must
+ * only be used by one thread at a time.
+ */
+class CommandAllocator {
+public:
+  CommandAllocator();
+  explicit CommandAllocator(const uint32_t queueFamily);
+  ~CommandAllocator();
+
+  CommandAllocator (const CommandAllocator&) = delete;
+  CommandAllocator& operator= (const CommandAllocator&) = delete;
+
+  VkCommandBuffer allocate(const VkCommandBufferLevel level = VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+  void reset();
+
+private:
+  // buffers of one level, the first used of them are handed out
+  struct FreeList {
+    std::vector<VkCommandBuffer> buffers;
+    uint32_t used = 0;
+  };
+
+  VkCommandPool pool = VK_NULL_HANDLE;
+  FreeList primaries;
+  FreeList secondaries;
+};
+
+}
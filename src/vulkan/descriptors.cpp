@@ -10,31 +10,32 @@ Descriptors::~Descriptors() {
   vkDestroyDescriptorPool(vk::device, pool, nullptr);
 }
 
-void Descriptors::createDescriptorPool(const unsigned int FRAME_COUNT) {
+void Descriptors::createDescriptorPool(const uint32_t framesInFlight) {
+  // each frame set holds a camera and an object uniform
   VkDescriptorPoolSize poolSize {};
-  poolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-  poolSize.descriptorCount = static_cast<uint32_t>(FRAME_COUNT);
+  poolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+  poolSize.descriptorCount = framesInFlight * 2;
 
   VkDescriptorPoolCreateInfo poolInfo {};
   poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
   poolInfo.poolSizeCount = 1;
   poolInfo.pPoolSizes = &poolSize;
-  poolInfo.maxSets = static_cast<uint32_t>(FRAME_COUNT);
+  poolInfo.maxSets = framesInFlight;
 
   if (vkCreateDescriptorPool(vk::device, &poolInfo, nullptr, &pool) != VK_SUCCESS) {
     throw std::runtime_error("[ERROR]: failed to create descriptor pool!");
   }
 }
 
-std::vector<VkDescriptorSet> Descriptors::createDescriptorSets(const unsigned int FRAME_COUNT, VkDescriptorSetLayout layout) {
-  std::vector<VkDescriptorSetLayout> layouts(FRAME_COUNT, layout);
+std::vector<VkDescriptorSet> Descriptors::createDescriptorSets(const uint32_t framesInFlight, VkDescriptorSetLayout layout) {
+  std::vector<VkDescriptorSetLayout> layouts(framesInFlight, layout);
   VkDescriptorSetAllocateInfo allocInfo{};
   allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
   allocInfo.descriptorPool = pool;
-  allocInfo.descriptorSetCount = static_cast<uint32_t>(FRAME_COUNT);
+  allocInfo.descriptorSetCount = framesInFlight;
   allocInfo.pSetLayouts = layouts.data();
 
-  std::vector<VkDescriptorSet> descriptorSets(FRAME_COUNT);
+  std::vector<VkDescriptorSet> descriptorSets(framesInFlight);
   if (vkAllocateDescriptorSets(vk::device, &allocInfo, descriptorSets.data()) != VK_SUCCESS) {
     throw std::runtime_error("failed to allocate descriptor sets!");
   }
@@ -42,20 +43,50 @@ std::vector<VkDescriptorSet> Descriptors::createDescriptorSets(const unsigned in
   return descriptorSets;
 }
 
+/**
+ * @brief point a dynamic uniform buffer binding of a descriptor set at a
+ *        buffer, the offset into it is given when the set is bound
+ * 
+ * @param set : descriptor set to update
+ * @param binding : binding of the uniform buffer in the set layout
+ * @param buffer : buffer to bind
+ * @param range : size of the region read at each dynamic offset
+ */
+void Descriptors::writeDynamicUniformBuffer(VkDescriptorSet set, uint32_t binding, VkBuffer buffer, VkDeviceSize range) {
+  VkDescriptorBufferInfo bufferInfo {};
+  bufferInfo.buffer = buffer;
+  bufferInfo.offset = 0;
+  bufferInfo.range = range;
+
+  VkWriteDescriptorSet descriptorWrite {};
+  descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+  descriptorWrite.dstSet = set;
+  descriptorWrite.dstBinding = binding;
+  descriptorWrite.dstArrayElement = 0;
+  descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+  descriptorWrite.descriptorCount = 1;
+  descriptorWrite.pBufferInfo = &bufferInfo;
+
+  vkUpdateDescriptorSets(vk::device, 1, &descriptorWrite, 0, nullptr);
+}
+
 namespace DescriptorLayouts {
 
-  VkDescriptorSetLayout createUBOLayout() {
-    VkDescriptorSetLayoutBinding uboLayoutBinding {};
-    uboLayoutBinding.binding = 0;
-    uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    uboLayoutBinding.descriptorCount = 1;
-    uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-    uboLayoutBinding.pImmutableSamplers = nullptr;
+  VkDescriptorSetLayout createFrameLayout() {
+    VkDescriptorSetLayoutBinding bindings[2] {};
+    bindings[0].binding = 0;
+    bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    bindings[0].descriptorCount = 1;
+    bindings[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    bindings[0].pImmutableSamplers = nullptr;
+
+    bindings[1] = bindings[0];
+    bindings[1].binding = 1;
 
     VkDescriptorSetLayoutCreateInfo layoutInfo {};
     layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-    layoutInfo.bindingCount = 1;
-    layoutInfo.pBindings = &uboLayoutBinding;
+    layoutInfo.bindingCount = 2;
+    layoutInfo.pBindings = bindings;
 
     VkDescriptorSetLayout descriptorSetLayout;
     if (vkCreateDescriptorSetLayout(vk::device, &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS) {
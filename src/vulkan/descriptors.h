@@ -2,29 +2,32 @@
 
 #include <vulkan/vulkan_core.h>
 
+#include <cstdint>
 #include <vector>
 
 namespace mb {
 
 class Descriptors {
 public:
-  Descriptors(const unsigned int FRAME_COUNT = 2) {
-    createDescriptorPool(FRAME_COUNT);
+  Descriptors(const uint32_t framesInFlight = 2) {
+    createDescriptorPool(framesInFlight);
   }
 
   ~Descriptors();
 
-  std::vector<VkDescriptorSet> createDescriptorSets(const unsigned int FRAME_COUNT, VkDescriptorSetLayout layout);
+  std::vector<VkDescriptorSet> createDescriptorSets(const uint32_t framesInFlight, VkDescriptorSetLayout layout);
+  void writeDynamicUniformBuffer(VkDescriptorSet set, uint32_t binding, VkBuffer buffer, VkDeviceSize range);
 
 private:
   VkDescriptorPool pool;
 
-  void createDescriptorPool(const unsigned int FRAME_COUNT);
+  void createDescriptorPool(const uint32_t framesInFlight);
 };
 
 namespace DescriptorLayouts {
 
-  VkDescriptorSetLayout createUBOLayout();
+  // dynamic uniform buffers for camera (binding 0) and per object (binding 1) data
+  VkDescriptorSetLayout createFrameLayout();
 
 }
 
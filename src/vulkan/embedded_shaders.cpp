@@ -0,0 +1,35 @@
+#include "embedded_shaders.h"
+
+#include <array>
+
+namespace mb {
+
+namespace {
+
+#ifdef MANABURN_EMBED_SHADERS
+  // generated from the compiled shaders by cmake/embed_shaders.cmake
+  #include "embedded_shaders.inl"
+#else
+  constexpr std::array<EmbeddedShader, 0> embeddedShaders {};
+#endif
+
+}
+
+namespace EmbeddedShaders {
+
+  bool isEnabled() {
+    return !embeddedShaders.empty();
+  }
+
+  const EmbeddedShader* find(std::string_view name) {
+    for (const auto& shader : embeddedShaders) {
+      if (name == shader.name) {
+        return &shader;
+      }
+    }
+    return nullptr;
+  }
+
+}
+
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace mb {
+
+/**
+ * @brief SPIR-V compiled into the executable, named after its .spv file
+ * 
+ */
+struct EmbeddedShader {
+  const char* name;
+  const uint32_t* code;
+  size_t size;
+};
+
+namespace EmbeddedShaders {
+
+  // false unless built with MANABURN_EMBED_SHADERS
+  bool isEnabled();
+  // looks up a shader by file name, e.g. "basic_shader.vert.spv"
+  const EmbeddedShader* find(std::string_view name);
+
+}
+
+}
@@ -0,0 +1,39 @@
+#include "frame_allocator.h"
+
+#include <stdexcept>
+
+namespace mb {
+
+FrameAllocator::FrameAllocator(const VkDeviceSize _capacity) : capacity(_capacity) {
+  VkPhysicalDeviceProperties properties;
+  vkGetPhysicalDeviceProperties(vk::physicalDevice, &properties);
+  alignment = properties.limits.minUniformBufferOffsetAlignment;
+
+  buffer.allocateBuffer(
+    VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, 
+    VMA_MEMORY_USAGE_AUTO, 
+    VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT, 
+    capacity
+  );
+  if (!buffer.mapped) {
+    throw std::runtime_error("[ERROR]: failed to map frame allocator");
+  }
+}
+
+/**
+ * @brief bump allocate memory aligned for use as a dynamic uniform buffer
+ * 
+ * @param size : size of the allocation in bytes
+ * @return FrameAllocation : mapped pointer and dynamic offset of the memory
+ */
+FrameAllocation FrameAllocator::allocate(const VkDeviceSize size) {
+  // sizes are rounded up, so every offset stays aligned
+  const VkDeviceSize alignedSize = (size + alignment - 1) / alignment * alignment;
+  const VkDeviceSize offset = head.fetch_add(alignedSize, std::memory_order_relaxed);
+  if (offset + size > capacity) {
+    throw std::runtime_error("[ERROR]: frame allocator is out of memory");
+  }
+  return {static_cast<char*>(buffer.mapped) + offset, static_cast<uint32_t>(offset)};
+}
+
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "buffer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+#include <vulkan/vulkan_core.h>
+
+namespace mb {
+
+/**
+ * @brief memory handed out by a frame allocator, offset is passed as the
+ *        dynamic offset of the descriptor reading it
+ * 
+ */
+struct FrameAllocation {
+  void* data;
+  uint32_t offset;
+};
+
+/**
+ * @brief linear allocator over one persistently mapped uniform buffer, owned
+ *        by a single frame in flight and reset once that frame has completed
+ * 
+ * Allocation is lock free so threads recording slices of a frame can push
+ * their uniforms concurrently, reset and flush must not overlap them.
+ */
+class FrameAllocator {
+public:
+  FrameAllocator(const VkDeviceSize _capacity);
+
+  FrameAllocator (const FrameAllocator&) = delete;
+  FrameAllocator& operator= (const FrameAllocator&) = delete;
+
+  FrameAllocation allocate(const VkDeviceSize size);
+
+  /**
+   * @brief copy a value into the frame
+   * 
+   * @return uint32_t : dynamic offset of the copy
+   */
+  template<typename T>
+  uint32_t push(const T& value) {
+    FrameAllocation allocation = allocate(sizeof(T));
+    std::memcpy(allocation.data, &value, sizeof(T));
+    return allocation.offset;
+  }
+
+  void reset() {head.store(0, std::memory_order_relaxed);}
+  void flush() {
+    const VkDeviceSize used = getUsed();
+    if (used > 0) buffer.flush(0, used);
+  }
+
+  VkBuffer getBuffer() const {return buffer.buffer;}
+  VkDeviceSize getCapacity() const {return capacity;}
+  VkDeviceSize getUsed() const {return std::min(head.load(std::memory_order_relaxed), capacity);}
+
+private:
+  Buffer buffer;
+  VkDeviceSize capacity;
+  VkDeviceSize alignment;
+  std::atomic<VkDeviceSize> head = 0;
+};
+
+}
@@ -0,0 +1,262 @@
+#include "gpu_profiler.h"
+#include "vk.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+
+namespace mb {
+
+GpuProfiler::GpuProfiler(const uint32_t framesInFlight, const uint32_t _maxScopes, const size_t _historySize) :
+maxScopes(_maxScopes), historySize(_historySize) {
+  VkPhysicalDeviceProperties properties;
+  vkGetPhysicalDeviceProperties(vk::physicalDevice, &properties);
+  timestampPeriod = properties.limits.timestampPeriod;
+
+  // timestamps are only meaningful if the graphics queue reports valid bits
+  uint32_t queueFamilyCount = 0;
+  vkGetPhysicalDeviceQueueFamilyProperties(vk::physicalDevice, &queueFamilyCount, nullptr);
+  std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+  vkGetPhysicalDeviceQueueFamilyProperties(vk::physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+  const uint32_t validBits = queueFamilies[vk::queueIndices.graphicsFamily.value()].timestampValidBits;
+  enabled = validBits != 0 && timestampPeriod > 0.0f;
+  timestampMask = validBits >= 64 ? UINT64_MAX : (uint64_t(1) << validBits) - 1;
+
+  createQueryPools(framesInFlight);
+}
+
+GpuProfiler::~GpuProfiler() {
+  destroyQueryPools();
+}
+
+/**
+ * @brief change the number of frames in flight, pending results are dropped
+ * 
+ * @param framesInFlight : number of query pools to keep
+ */
+void GpuProfiler::resize(const uint32_t framesInFlight) {
+  destroyQueryPools();
+  createQueryPools(framesInFlight);
+}
+
+/**
+ * @brief create one timestamp query pool for every frame in flight
+ * 
+ */
+void GpuProfiler::createQueryPools(const uint32_t framesInFlight) {
+  frames.resize(framesInFlight);
+  currentFrame = 0;
+  if (!enabled) return;
+
+  for (auto& frame : frames) {
+    VkQueryPoolCreateInfo poolInfo {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    poolInfo.queryCount = maxScopes * 2;
+
+    if (vkCreateQueryPool(vk::device, &poolInfo, nullptr, &frame.pool) != VK_SUCCESS) {
+      throw std::runtime_error("[ERROR]: failed to create timestamp query pool");
+    }
+  }
+}
+
+void GpuProfiler::destroyQueryPools() {
+  for (auto& frame : frames) {
+    if (frame.pool) {
+      vkDestroyQueryPool(vk::device, frame.pool, nullptr);
+    }
+  }
+  frames.clear();
+}
+
+/**
+ * @brief read back the results of the last use of a frame slot and reset its
+ *        queries, must be recorded outside of a render pass after the slot's
+ *        previous submission has completed
+ * 
+ * @param cmd : command buffer of the frame
+ * @param frame : index of the frame in flight
+ */
+void GpuProfiler::beginFrame(VkCommandBuffer cmd, const uint32_t frame) {
+  currentFrame = frame;
+  if (!enabled) return;
+
+  FrameQueries& queries = frames[currentFrame];
+  if (queries.pending) {
+    collectResults(queries);
+  }
+
+  vkCmdResetQueryPool(cmd, queries.pool, 0, maxScopes * 2);
+  queries.scopeNames.clear();
+  queries.pending = true;
+}
+
+/**
+ * @brief read back the results of every frame slot that has not been reused
+ *        yet, call once their submissions have completed
+ * 
+ */
+void GpuProfiler::collect() {
+  if (!enabled) return;
+
+  for (auto& queries : frames) {
+    if (queries.pending) {
+      collectResults(queries);
+    }
+  }
+}
+
+/**
+ * @brief write the starting timestamp of a named scope
+ * 
+ * @param cmd : command buffer to time
+ * @param name : name the results are reported under
+ * @return uint32_t : scope to pass to endScope
+ */
+uint32_t GpuProfiler::beginScope(VkCommandBuffer cmd, const std::string& name) {
+  if (!enabled) return INVALID_SCOPE;
+
+  FrameQueries& queries = frames[currentFrame];
+  if (queries.scopeNames.size() >= maxScopes) {
+    return INVALID_SCOPE;
+  }
+
+  const uint32_t scope = static_cast<uint32_t>(queries.scopeNames.size());
+  queries.scopeNames.push_back(name);
+  vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queries.pool, scope * 2);
+  return scope;
+}
+
+/**
+ * @brief write the ending timestamp of a scope
+ * 
+ * @param cmd : command buffer to time
+ * @param scope : scope returned by beginScope
+ */
+void GpuProfiler::endScope(VkCommandBuffer cmd, const uint32_t scope) {
+  if (!enabled || scope == INVALID_SCOPE) return;
+
+  vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, frames[currentFrame].pool, scope * 2 + 1);
+}
+
+/**
+ * @brief copy available timestamps into the scope history without waiting
+ * 
+ */
+void GpuProfiler::collectResults(FrameQueries& frame) {
+  frame.pending = false;
+  if (frame.scopeNames.empty()) return;
+
+  // each query returns its value followed by its availability
+  const uint32_t queryCount = static_cast<uint32_t>(frame.scopeNames.size()) * 2;
+  std::vector<uint64_t> results(queryCount * 2);
+  const VkResult result = vkGetQueryPoolResults(
+    vk::device, 
+    frame.pool, 
+    0, 
+    queryCount, 
+    results.size() * sizeof(uint64_t), 
+    results.data(), 
+    sizeof(uint64_t) * 2, 
+    VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT
+  );
+  if (result != VK_SUCCESS && result != VK_NOT_READY) {
+    return;
+  }
+
+  for (size_t scope = 0; scope < frame.scopeNames.size(); scope++) {
+    const uint64_t* begin = &results[scope * 4];
+    const uint64_t* end = &results[scope * 4 + 2];
+    // skip scopes that were never closed or are not available yet
+    if (begin[1] == 0 || end[1] == 0) continue;
+
+    const uint64_t ticks = ((end[0] & timestampMask) - (begin[0] & timestampMask)) & timestampMask;
+    addSample(frame.scopeNames[scope], ticks * timestampPeriod / 1000000.0);
+  }
+}
+
+void GpuProfiler::addSample(const std::string& name, const double ms) {
+  ScopeHistory& scope = history[name];
+  if (scope.samples.size() < historySize) {
+    scope.samples.push_back(ms);
+  }
+  else {
+    scope.samples[scope.next] = ms;
+  }
+  scope.next = (scope.next + 1) % historySize;
+  scope.lastMs = ms;
+}
+
+/**
+ * @brief compute the rolling statistics of a scope
+ * 
+ * @param name : name of the scope
+ * @return std::optional<GpuScopeStats> : empty if the scope has no samples
+ */
+std::optional<GpuScopeStats> GpuProfiler::getStats(const std::string& name) const {
+  auto it = history.find(name);
+  if (it == history.end() || it->second.samples.empty()) {
+    return std::nullopt;
+  }
+
+  std::vector<double> samples = it->second.samples;
+  GpuScopeStats stats {};
+  stats.samples = samples.size();
+  stats.lastMs = it->second.lastMs;
+  stats.minMs = *std::min_element(samples.begin(), samples.end());
+  double total = 0.0;
+  for (const double sample : samples) {
+    total += sample;
+  }
+  stats.avgMs = total / samples.size();
+
+  const size_t p99Index = static_cast<size_t>(std::ceil(samples.size() * 0.99)) - 1;
+  std::nth_element(samples.begin(), samples.begin() + p99Index, samples.end());
+  stats.p99Ms = samples[p99Index];
+
+  return stats;
+}
+
+std::vector<std::string> GpuProfiler::getScopeNames() const {
+  std::vector<std::string> names;
+  names.reserve(history.size());
+  for (const auto& [name, scope] : history) {
+    names.push_back(name);
+  }
+  std::sort(names.begin(), names.end());
+  return names;
+}
+
+/**
+ * @brief write the statistics of every scope to a text file, a file that
+ *        cannot be opened is reported and skipped
+ * 
+ * @param filePath : file to write
+ */
+void GpuProfiler::dump(const std::string& filePath) const {
+  std::ofstream file(filePath);
+  if (!file.is_open()) {
+    std::cerr << "[WARNING]: failed to open gpu profile " << filePath << "\n";
+    return;
+  }
+
+  file << std::left << std::setw(32) << "scope" << std::right
+       << std::setw(12) << "min ms" << std::setw(12) << "avg ms"
+       << std::setw(12) << "p99 ms" << std::setw(12) << "last ms"
+       << std::setw(10) << "samples" << "\n";
+  file << std::fixed << std::setprecision(4);
+  for (const auto& name : getScopeNames()) {
+    const auto stats = getStats(name);
+    if (!stats) continue;
+    file << std::left << std::setw(32) << name << std::right
+         << std::setw(12) << stats->minMs << std::setw(12) << stats->avgMs
+         << std::setw(12) << stats->p99Ms << std::setw(12) << stats->lastMs
+         << std::setw(10) << stats->samples << "\n";
+  }
+}
+
+}
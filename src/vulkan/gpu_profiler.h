@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <vulkan/vulkan_core.h>
+
+namespace mb {
+
+/**
+ * @brief rolling timing statistics for a profiled GPU scope, in milliseconds
+ * 
+ */
+struct GpuScopeStats {
+  double minMs = 0.0;
+  double avgMs = 0.0;
+  double p99Ms = 0.0;
+  double lastMs = 0.0;
+  size_t samples = 0;
+};
+
+/**
+ * @brief times named scopes of a command buffer with timestamp queries, one
+ *        query pool per frame in flight, read back when the frame slot is reused
+ * 
+ */
+class GpuProfiler {
+public:
+  static constexpr uint32_t INVALID_SCOPE = UINT32_MAX;
+
+  GpuProfiler(const uint32_t framesInFlight, const uint32_t _maxScopes = 64, const size_t _historySize = 256);
+  ~GpuProfiler();
+
+  GpuProfiler (const GpuProfiler&) = delete;
+  GpuProfiler& operator= (const GpuProfiler&) = delete;
+
+  void resize(const uint32_t framesInFlight);
+
+  void beginFrame(VkCommandBuffer cmd, const uint32_t frame);
+  uint32_t beginScope(VkCommandBuffer cmd, const std::string& name);
+  void endScope(VkCommandBuffer cmd, const uint32_t scope);
+  void collect();
+
+  bool isEnabled() const {return enabled;}
+  std::optional<GpuScopeStats> getStats(const std::string& name) const;
+  std::vector<std::string> getScopeNames() const;
+  void dump(const std::string& filePath) const;
+
+private:
+  // queries written by one frame in flight
+  struct FrameQueries {
+    VkQueryPool pool = VK_NULL_HANDLE;
+    std::vector<std::string> scopeNames;
+    bool pending = false;
+  };
+
+  // ring buffer of the most recent samples of a scope
+  struct ScopeHistory {
+    std::vector<double> samples;
+    size_t next = 0;
+    double lastMs = 0.0;
+  };
+
+  bool enabled = false;
+  double timestampPeriod = 1.0;
+  uint64_t timestampMask = UINT64_MAX;
+  uint32_t maxScopes;
+  size_t historySize;
+
+  std::vector<FrameQueries> frames;
+  uint32_t currentFrame = 0;
+  std::unordered_map<std::string, ScopeHistory> history;
+
+  void createQueryPools(const uint32_t framesInFlight);
+  void destroyQueryPools();
+  void collectResults(FrameQueries& frame);
+  void addSample(const std::string& name, const double ms);
+};
+
+/**
+ * @brief times the commands recorded during its lifetime
+ * 
+ */
+class GpuScope {
+public:
+  GpuScope(GpuProfiler& _profiler, VkCommandBuffer _cmd, const std::string& name) :
+  profiler(_profiler), cmd(_cmd) {
+    scope = profiler.beginScope(cmd, name);
+  }
+
+  ~GpuScope() {
+    profiler.endScope(cmd, scope);
+  }
+
+  GpuScope (const GpuScope&) = delete;
+  GpuScope& operator= (const GpuScope&) = delete;
+
+private:
+  GpuProfiler& profiler;
+  VkCommandBuffer cmd;
+  uint32_t scope;
+};
+
+}
@@ -12,8 +12,18 @@ public:
   ImageBuffer(){}
   ~ImageBuffer(){clear();}
 
-  void createImage(uint32_t width, uint32_t height, uint32_t depth, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage) {
+  void createImage(
+      uint32_t width, 
+      uint32_t height, 
+      uint32_t depth, 
+      VkFormat format, 
+      VkImageTiling tiling, 
+      VkImageUsageFlags usage,
+      VmaMemoryUsage memUsage = VMA_MEMORY_USAGE_AUTO,
+      VmaAllocationCreateFlags memFlags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT
+  ) {
     VkImageCreateInfo imageInfo {};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
     imageInfo.imageType = depth == 1 ? VK_IMAGE_TYPE_2D : VK_IMAGE_TYPE_3D;
     imageInfo.extent.width = static_cast<uint32_t>(width);
     imageInfo.extent.height = static_cast<uint32_t>(height);
@@ -29,15 +39,18 @@ public:
     imageInfo.flags = 0;
 
     VmaAllocationCreateInfo allocCreateInfo {};
-    allocCreateInfo.usage = VMA_MEMORY_USAGE_AUTO;
-    allocCreateInfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
+    allocCreateInfo.usage = memUsage;
+    allocCreateInfo.flags = memFlags;
 
-    vmaCreateImage(vk::allocator, &imageInfo, &allocCreateInfo, &image, &allocation, nullptr);
+    if (vmaCreateImage(vk::allocator, &imageInfo, &allocCreateInfo, &image, &allocation, nullptr) != VK_SUCCESS) {
+      throw std::runtime_error("[ERROR]: failed to create image");
+    }
   }
 
   void clear() {
     if (image) {
       vmaDestroyImage(vk::allocator, image, allocation);
+      image = VK_NULL_HANDLE;
     }
   }
 
@@ -47,9 +60,11 @@ public:
     }
   }
 
+  VkImage get() {return image;}
+
 private:
-  VkImage image;
+  VkImage image = VK_NULL_HANDLE;
   VmaAllocation allocation;
 };
 
-}
\ No newline at end of file
+}
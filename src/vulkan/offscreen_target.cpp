@@ -0,0 +1,186 @@
+#include "offscreen_target.h"
+#include "image_buffer.h"
+#include "vk.h"
+
+#include <cstddef>
+#include <stdexcept>
+
+#include <vulkan/vulkan_core.h>
+
+namespace mb {
+
+OffscreenTarget::OffscreenTarget(VkExtent2D _extent, uint32_t _imageCount, VkFormat _format, bool _useRenderPass) :
+format(_format), extent(_extent), imageCount(_imageCount), useRenderPass(_useRenderPass) {
+  createImages();
+  createImageViews();
+  if (useRenderPass) {
+    createRenderPass();
+    createFramebuffers();
+  }
+}
+
+OffscreenTarget::~OffscreenTarget() {
+  cleanup();
+  if (renderPass) vkDestroyRenderPass(vk::device, renderPass, nullptr);
+}
+
+/**
+ * @brief reallocate the color targets with a new size or image count
+ * 
+ * @param _extent : dimensions of the color targets
+ * @param _imageCount : number of color targets to allocate
+ */
+void OffscreenTarget::recreate(VkExtent2D _extent, uint32_t _imageCount) {
+  vkDeviceWaitIdle(vk::device);
+
+  cleanup();
+
+  extent = _extent;
+  imageCount = _imageCount;
+  createImages();
+  createImageViews();
+  if (useRenderPass) {
+    createFramebuffers();
+  }
+}
+
+/**
+ * @brief allocate device local color images to render into
+ * 
+ */
+void OffscreenTarget::createImages() {
+  images.resize(imageCount);
+  for (auto& image : images) {
+    image = std::make_unique<ImageBuffer>();
+    image->createImage(
+      extent.width, 
+      extent.height, 
+      1, 
+      format, 
+      VK_IMAGE_TILING_OPTIMAL, 
+      VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+      VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE,
+      0
+    );
+  }
+}
+
+/**
+ * @brief creates image views to access the color images
+ * 
+ */
+void OffscreenTarget::createImageViews() {
+  imageViews.resize(images.size());
+  for (size_t i = 0; i < images.size(); i++) {
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = images[i]->get();
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = format;
+
+    viewInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
+    viewInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+    viewInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+    viewInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+
+    viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    viewInfo.subresourceRange.baseMipLevel = 0;
+    viewInfo.subresourceRange.levelCount = 1;
+    viewInfo.subresourceRange.baseArrayLayer = 0;
+    viewInfo.subresourceRange.layerCount = 1;
+
+    if (vkCreateImageView(vk::device, &viewInfo, nullptr, &imageViews[i]) != VK_SUCCESS) {
+      throw std::runtime_error("[ERROR]: failed to create offscreen image views");
+    }
+  }
+}
+
+/**
+ * @brief creates a render pass that leaves the color target ready for readback
+ * 
+ */
+void OffscreenTarget::createRenderPass() {
+  VkAttachmentDescription colorAttachment {};
+  colorAttachment.format = format;
+  colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+  colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+  colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+  colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+  colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  colorAttachment.finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+
+  VkAttachmentReference colorAttachmentRef {};
+  colorAttachmentRef.attachment = 0;
+  colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+  VkSubpassDescription subpass {};
+  subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+  subpass.colorAttachmentCount = 1;
+  subpass.pColorAttachments = &colorAttachmentRef;
+
+  VkSubpassDependency dependency{};
+  dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+  dependency.dstSubpass = 0;
+  dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+  dependency.srcAccessMask = 0;
+  dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+  dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+  VkRenderPassCreateInfo renderPassInfo {};
+  renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+  renderPassInfo.attachmentCount = 1;
+  renderPassInfo.pAttachments = &colorAttachment;
+  renderPassInfo.subpassCount = 1;
+  renderPassInfo.pSubpasses = &subpass;
+  renderPassInfo.dependencyCount = 1;
+  renderPassInfo.pDependencies = &dependency;
+
+  if (vkCreateRenderPass(vk::device, &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
+    throw std::runtime_error("[ERROR]: Failed to create offscreen render pass");
+  }
+}
+
+/**
+ * @brief create a frame buffer for every image view
+ * 
+ */
+void OffscreenTarget::createFramebuffers() {
+  framebuffers.resize(imageViews.size());
+  for (size_t i = 0; i < imageViews.size(); i++) {
+    VkImageView attachments[] = {
+      imageViews[i]
+    };
+
+    VkFramebufferCreateInfo framebufferInfo {};
+    framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebufferInfo.renderPass = renderPass;
+    framebufferInfo.attachmentCount = 1;
+    framebufferInfo.pAttachments = attachments;
+    framebufferInfo.width = extent.width;
+    framebufferInfo.height = extent.height;
+    framebufferInfo.layers = 1;
+
+    if (vkCreateFramebuffer(vk::device, &framebufferInfo, nullptr, &framebuffers[i]) != VK_SUCCESS) {
+      throw std::runtime_error("[ERROR]: failed to create offscreen framebuffer");
+    }
+  }
+}
+
+/**
+ * @brief destroy the color targets and all handlers that depend on them
+ * 
+ */
+void OffscreenTarget::cleanup() {
+  for (auto& framebuffer : framebuffers) {
+    vkDestroyFramebuffer(vk::device, framebuffer, nullptr);
+  }
+  for (auto& view : imageViews) {
+    vkDestroyImageView(vk::device, view, nullptr);
+  }
+  framebuffers.clear();
+  imageViews.clear();
+  images.clear();
+}
+
+}
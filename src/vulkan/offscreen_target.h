@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <vulkan/vulkan_core.h>
+
+namespace mb {
+
+class ImageBuffer;
+
+/**
+ * @brief VMA allocated color targets used in place of a swapchain
+ *        when the engine runs without a display
+ * 
+ */
+class OffscreenTarget {
+public:
+  OffscreenTarget(VkExtent2D _extent, uint32_t _imageCount, VkFormat _format = VK_FORMAT_R8G8B8A8_UNORM, bool _useRenderPass = true);
+  ~OffscreenTarget();
+
+  void recreate(VkExtent2D _extent, uint32_t _imageCount);
+
+  // vulkan handles
+  std::vector<std::unique_ptr<ImageBuffer>> images;
+  std::vector<VkImageView> imageViews;
+  // only created when not rendering dynamically
+  VkRenderPass renderPass = VK_NULL_HANDLE;
+  std::vector<VkFramebuffer> framebuffers;
+
+  // chosen target settings
+  VkFormat format;
+  VkExtent2D extent;
+  uint32_t imageCount;
+private:
+  bool useRenderPass;
+
+  void createImages();
+  void createImageViews();
+  void createRenderPass();
+  void createFramebuffers();
+  void cleanup();
+};
+
+}
@@ -0,0 +1,118 @@
+#include "parallel_recorder.h"
+
+#include "../util/profiler.h"
+
+#include <algorithm>
+#include <exception>
+#include <future>
+#include <stdexcept>
+
+namespace mb {
+
+/**
+ * @brief create the command allocators of every slice
+ *
+ * @param _threadPool : workers the slices are recorded on
+ * @param framesInFlight : number of frames that may be recording or executing
+ * @param _minSliceSize : fewest draws worth handing to another thread
+ */
+ParallelRecorder::ParallelRecorder(ThreadPool& _threadPool, const uint32_t framesInFlight, const uint32_t _minSliceSize) :
+threadPool(_threadPool), minSliceSize(std::max(_minSliceSize, 1u)) {
+  const uint32_t sliceCount = threadPool.getThreadCount() + 1;
+  frames.resize(framesInFlight);
+  for (auto& allocators : frames) {
+    for (uint32_t i = 0; i < sliceCount; i++) {
+      allocators.push_back(std::make_unique<CommandAllocator>());
+    }
+  }
+}
+
+/**
+ * @brief record a draw list across the workers and execute the slices in
+ *        order from the primary buffer
+ *
+ * The primary must be inside a render pass or dynamic rendering begun for
+ * secondary command buffers. The function is called concurrently, it must
+ * only touch state that is safe to share between threads.
+ *
+ * @param primary : command buffer that executes the slices
+ * @param frame : frame in flight being recorded, its previous use must have completed
+ * @param inheritance : render pass or dynamic rendering state the slices continue
+ * @param drawCount : number of draws in the list
+ * @param function : records a slice of the draws
+ */
+void ParallelRecorder::record(
+  VkCommandBuffer primary,
+  const uint32_t frame,
+  const VkCommandBufferInheritanceInfo& inheritance,
+  const uint32_t drawCount,
+  const RecordFunction& function
+) {
+  MB_PROFILE_ZONE("ParallelRecorder::record");
+
+  auto& allocators = frames[frame];
+  const uint32_t sliceCount = std::clamp((drawCount + minSliceSize - 1) / minSliceSize, 1u, static_cast<uint32_t>(allocators.size()));
+  const uint32_t sliceSize = (drawCount + sliceCount - 1) / sliceCount;
+
+  std::vector<VkCommandBuffer> buffers(sliceCount);
+  for (uint32_t i = 0; i < sliceCount; i++) {
+    allocators[i]->reset();
+    buffers[i] = allocators[i]->allocate(VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+  }
+
+  // hand every slice but the first to the workers, the caller records that one
+  std::vector<std::future<void>> pending;
+  pending.reserve(sliceCount - 1);
+  for (uint32_t i = 1; i < sliceCount; i++) {
+    const uint32_t first = std::min(i * sliceSize, drawCount);
+    const uint32_t count = std::min(sliceSize, drawCount - first);
+    pending.push_back(threadPool.submit([this, buffer = buffers[i], &inheritance, &function, first, count]() {
+      recordSlice(buffer, inheritance, first, count, function);
+    }));
+  }
+  std::exception_ptr error;
+  try {
+    recordSlice(buffers[0], inheritance, 0, std::min(sliceSize, drawCount), function);
+  }
+  catch (...) {
+    error = std::current_exception();
+  }
+
+  // wait for every slice before rethrowing, the workers reference this frame
+  for (auto& slice : pending) {
+    slice.wait();
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+  for (auto& slice : pending) {
+    slice.get();
+  }
+
+  vkCmdExecuteCommands(primary, sliceCount, buffers.data());
+}
+
+/**
+ * @brief record one slice of the draw list into its secondary buffer
+ *
+ */
+void ParallelRecorder::recordSlice(VkCommandBuffer buffer, const VkCommandBufferInheritanceInfo& inheritance,
+  const uint32_t first, const uint32_t count, const RecordFunction& function) {
+  MB_PROFILE_ZONE("record-slice");
+
+  VkCommandBufferBeginInfo beginInfo {};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+  beginInfo.pInheritanceInfo = &inheritance;
+  if (vkBeginCommandBuffer(buffer, &beginInfo) != VK_SUCCESS) {
+    throw std::runtime_error("[ERROR]: failed to begin recording secondary command buffer");
+  }
+
+  function(buffer, first, count);
+
+  if (vkEndCommandBuffer(buffer) != VK_SUCCESS) {
+    throw std::runtime_error("[ERROR]: failed to record secondary command buffer");
+  }
+}
+
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "command_allocator.h"
+#include "../util/thread_pool.h"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <vulkan/vulkan_core.h>
+
+namespace mb {
+
+/**
+ * @brief records a draw list into secondary command buffers on a thread
+ *        pool, split into one slice per worker plus one for the calling thread
+ *
+ * Every slice has a command allocator per frame in flight, so no pool is
+ * ever used by two threads at once. A frame's allocators are reset the next
+ * time it records, the caller must have waited for it to complete.
+ */
+class ParallelRecorder {
+public:
+  // records draws [first, first + count) into a secondary command buffer
+  using RecordFunction = std::function<void(VkCommandBuffer buffer, const uint32_t first, const uint32_t count)>;
+
+  ParallelRecorder(ThreadPool& _threadPool, const uint32_t framesInFlight, const uint32_t _minSliceSize = 128);
+
+  ParallelRecorder (const ParallelRecorder&) = delete;
+  ParallelRecorder& operator= (const ParallelRecorder&) = delete;
+
+  void record(
+    VkCommandBuffer primary,
+    const uint32_t frame,
+    const VkCommandBufferInheritanceInfo& inheritance,
+    const uint32_t drawCount,
+    const RecordFunction& function
+  );
+
+  uint32_t getMinSliceSize() const {return minSliceSize;}
+
+private:
+  ThreadPool& threadPool;
+  uint32_t minSliceSize;
+  // allocator of every slice, per frame in flight
+  std::vector<std::vector<std::unique_ptr<CommandAllocator>>> frames;
+
+  void recordSlice(VkCommandBuffer buffer, const VkCommandBufferInheritanceInfo& inheritance,
+    const uint32_t first, const uint32_t count, const RecordFunction& function);
+};
+
+}
@@ -1,12 +1,84 @@
 #include "pipeline_builder.h"
 #include "vk.h"
 
+#include "../util/hash.h"
+
 #include <cstdint>
+#include <cstring>
 #include <fstream>
 #include <stdexcept>
 
 namespace mb {
 
+namespace {
+
+/**
+ * @brief first topology of a topology class, pipelines with a dynamic
+ *        topology only fix its class
+ * 
+ */
+VkPrimitiveTopology topologyClass(const VkPrimitiveTopology topology) {
+  switch (topology) {
+    case VK_PRIMITIVE_TOPOLOGY_POINT_LIST:
+      return VK_PRIMITIVE_TOPOLOGY_POINT_LIST;
+    case VK_PRIMITIVE_TOPOLOGY_LINE_LIST:
+    case VK_PRIMITIVE_TOPOLOGY_LINE_STRIP:
+    case VK_PRIMITIVE_TOPOLOGY_LINE_LIST_WITH_ADJACENCY:
+    case VK_PRIMITIVE_TOPOLOGY_LINE_STRIP_WITH_ADJACENCY:
+      return VK_PRIMITIVE_TOPOLOGY_LINE_LIST;
+    case VK_PRIMITIVE_TOPOLOGY_PATCH_LIST:
+      return VK_PRIMITIVE_TOPOLOGY_PATCH_LIST;
+    default:
+      return VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+  }
+}
+
+template<typename T>
+uint64_t hashValue(const uint64_t hash, const T& value) {
+  return fnv1a(&value, sizeof(T), hash);
+}
+
+template<typename T>
+uint64_t hashVector(const uint64_t hash, const std::vector<T>& values) {
+  return fnv1a(values.data(), values.size() * sizeof(T), hashValue(hash, values.size()));
+}
+
+}
+
+/**
+ * @brief set the state of the draw, only the groups the device sets
+ *        dynamically are recorded, the rest is baked into the bound pipeline
+ * 
+ * @param buffer : command buffer the pipeline is bound in
+ */
+void RenderState::record(VkCommandBuffer buffer) const {
+  const ExtendedDynamicState& dynamicState = vk::extendedDynamicState;
+  if (dynamicState.state1) {
+    vk::cmdSetPrimitiveTopology(buffer, topology);
+    vk::cmdSetCullMode(buffer, cullMode);
+    vk::cmdSetFrontFace(buffer, frontFace);
+    vk::cmdSetDepthTestEnable(buffer, depthTestEnable);
+    vk::cmdSetDepthWriteEnable(buffer, depthWriteEnable);
+    vk::cmdSetDepthCompareOp(buffer, depthCompareOp);
+  }
+  if (dynamicState.state2) {
+    vk::cmdSetPrimitiveRestartEnable(buffer, primitiveRestartEnable);
+    vk::cmdSetDepthBiasEnable(buffer, depthBiasEnable);
+  }
+  if (dynamicState.blend) {
+    VkColorBlendEquationEXT equation {};
+    equation.srcColorBlendFactor = colorBlendAttachment.srcColorBlendFactor;
+    equation.dstColorBlendFactor = colorBlendAttachment.dstColorBlendFactor;
+    equation.colorBlendOp = colorBlendAttachment.colorBlendOp;
+    equation.srcAlphaBlendFactor = colorBlendAttachment.srcAlphaBlendFactor;
+    equation.dstAlphaBlendFactor = colorBlendAttachment.dstAlphaBlendFactor;
+    equation.alphaBlendOp = colorBlendAttachment.alphaBlendOp;
+    vk::cmdSetColorBlendEnable(buffer, 0, 1, &colorBlendAttachment.blendEnable);
+    vk::cmdSetColorBlendEquation(buffer, 0, 1, &equation);
+    vk::cmdSetColorWriteMask(buffer, 0, 1, &colorBlendAttachment.colorWriteMask);
+  }
+}
+
 PipelineBuilder::PipelineBuilder() {
   clear();
 }
@@ -21,7 +93,9 @@ PipelineBuilder::~PipelineBuilder() {
  */
 void PipelineBuilder::clear() {
   shaderStages.clear();
-  vertexInputInfo = { .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO };
+  specializations.clear();
+  vertexBindings.clear();
+  vertexAttributes.clear();
   inputAssemblyInfo = { .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO};
   rasterizationInfo = { .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO };
   mutlisampleInfo = { .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO };
@@ -41,20 +115,39 @@ VkShaderModule PipelineBuilder::createShader(std::string shaderFilePath) {
 }
 
 /**
- * @brief build the graphics pipeline with the included settings
+ * @brief build the graphics pipeline, safe to call from any thread
  * 
- * @param renderPass : render pass the use in the pipeline
+ * @param cache : pipeline cache to compile through, or VK_NULL_HANDLE
  * @return VkPipeline : the built pipeline
  */
-VkPipeline PipelineBuilder::build(VkRenderPass renderPass) {
+VkPipeline PipelineDescription::build(VkPipelineCache cache) const {
+  // permutations of the dynamic state compile to identical create infos
+  const PipelineDescription state = baked();
+
   // set dynamic states
-  VkDynamicState dynamicState[2] = {
+  std::vector<VkDynamicState> dynamicStates = {
     VK_DYNAMIC_STATE_SCISSOR, VK_DYNAMIC_STATE_VIEWPORT
   };
+  if (dynamicState.state1) {
+    dynamicStates.insert(dynamicStates.end(), {
+      VK_DYNAMIC_STATE_PRIMITIVE_TOPOLOGY, VK_DYNAMIC_STATE_CULL_MODE, VK_DYNAMIC_STATE_FRONT_FACE,
+      VK_DYNAMIC_STATE_DEPTH_TEST_ENABLE, VK_DYNAMIC_STATE_DEPTH_WRITE_ENABLE, VK_DYNAMIC_STATE_DEPTH_COMPARE_OP
+    });
+  }
+  if (dynamicState.state2) {
+    dynamicStates.insert(dynamicStates.end(), {
+      VK_DYNAMIC_STATE_PRIMITIVE_RESTART_ENABLE, VK_DYNAMIC_STATE_DEPTH_BIAS_ENABLE
+    });
+  }
+  if (dynamicState.blend) {
+    dynamicStates.insert(dynamicStates.end(), {
+      VK_DYNAMIC_STATE_COLOR_BLEND_ENABLE_EXT, VK_DYNAMIC_STATE_COLOR_BLEND_EQUATION_EXT, VK_DYNAMIC_STATE_COLOR_WRITE_MASK_EXT
+    });
+  }
   VkPipelineDynamicStateCreateInfo dynamicInfo {};
   dynamicInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-  dynamicInfo.dynamicStateCount = 2;
-  dynamicInfo.pDynamicStates = dynamicState;
+  dynamicInfo.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+  dynamicInfo.pDynamicStates = dynamicStates.data();
 
   VkPipelineViewportStateCreateInfo viewportInfo {};
   viewportInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
@@ -65,33 +158,209 @@ VkPipeline PipelineBuilder::build(VkRenderPass renderPass) {
   VkPipelineColorBlendStateCreateInfo colorBlendInfo {};
   colorBlendInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
   colorBlendInfo.attachmentCount = 1;
-  colorBlendInfo.pAttachments = &colorBlendAttachment;
+  colorBlendInfo.pAttachments = &state.colorBlendAttachment;
   colorBlendInfo.logicOpEnable = VK_FALSE;
   colorBlendInfo.logicOp = VK_LOGIC_OP_COPY;
 
+  VkPipelineVertexInputStateCreateInfo vertexInputInfo {};
+  vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+  vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(vertexBindings.size());
+  vertexInputInfo.pVertexBindingDescriptions = vertexBindings.data();
+  vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(vertexAttributes.size());
+  vertexInputInfo.pVertexAttributeDescriptions = vertexAttributes.data();
+
+  // point each stage at its specialization constants, if it has any
+  std::vector<VkPipelineShaderStageCreateInfo> stages = shaderStages;
+  std::vector<VkSpecializationInfo> specializationInfos(stages.size());
+  for (size_t i = 0; i < stages.size(); i++) {
+    for (const auto& specialization : specializations) {
+      if (specialization.stage != stages[i].stage || specialization.entries.empty()) continue;
+      specializationInfos[i].mapEntryCount = static_cast<uint32_t>(specialization.entries.size());
+      specializationInfos[i].pMapEntries = specialization.entries.data();
+      specializationInfos[i].dataSize = specialization.data.size();
+      specializationInfos[i].pData = specialization.data.data();
+      stages[i].pSpecializationInfo = &specializationInfos[i];
+    }
+  }
+
   VkGraphicsPipelineCreateInfo pipelineInfo {};
   pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-  pipelineInfo.stageCount = static_cast<uint32_t>(shaderStages.size());
-  pipelineInfo.pStages = shaderStages.data();
+  pipelineInfo.stageCount = static_cast<uint32_t>(stages.size());
+  pipelineInfo.pStages = stages.data();
   pipelineInfo.pVertexInputState = &vertexInputInfo;
-  pipelineInfo.pInputAssemblyState = &inputAssemblyInfo;
-  pipelineInfo.pRasterizationState = &rasterizationInfo;
+  pipelineInfo.pInputAssemblyState = &state.inputAssemblyInfo;
+  pipelineInfo.pRasterizationState = &state.rasterizationInfo;
   pipelineInfo.pViewportState = &viewportInfo;
-  pipelineInfo.pMultisampleState = &mutlisampleInfo;
+  pipelineInfo.pMultisampleState = &multisampleInfo;
   pipelineInfo.pDepthStencilState = nullptr;
   pipelineInfo.pColorBlendState = &colorBlendInfo;
   pipelineInfo.pDynamicState = &dynamicInfo;
   pipelineInfo.layout = layout;
   pipelineInfo.renderPass = renderPass;
 
+  // dynamic rendering describes the attachments instead of a render pass
+  VkPipelineRenderingCreateInfo renderingInfo {};
+  renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+  renderingInfo.colorAttachmentCount = static_cast<uint32_t>(colorFormats.size());
+  renderingInfo.pColorAttachmentFormats = colorFormats.data();
+  renderingInfo.depthAttachmentFormat = depthFormat;
+  renderingInfo.stencilAttachmentFormat = VK_FORMAT_UNDEFINED;
+  if (renderPass == VK_NULL_HANDLE) {
+    pipelineInfo.pNext = &renderingInfo;
+  }
+
   VkPipeline pipeline;
-  if (vkCreateGraphicsPipelines(vk::device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
+  if (vkCreateGraphicsPipelines(vk::device, cache, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
     throw std::runtime_error("[ERROR]: Failed to create graphics pipeline");
   }
 
   return pipeline;
 }
 
+/**
+ * @brief hash of the state baked into the pipeline, descriptions that only
+ *        differ in dynamic state hash the same and can share a pipeline
+ * 
+ * @return uint64_t : 64 bit FNV-1a hash
+ */
+uint64_t PipelineDescription::hash() const {
+  const PipelineDescription state = baked();
+
+  uint64_t hash = FNV_OFFSET_BASIS;
+  hash = hashValue(hash, layout);
+  hash = hashValue(hash, renderPass);
+  hash = hashVector(hash, colorFormats);
+  hash = hashValue(hash, depthFormat);
+  for (const auto& stage : shaderStages) {
+    hash = hashValue(hash, stage.stage);
+    hash = hashValue(hash, stage.module);
+    hash = fnv1a(stage.pName, std::strlen(stage.pName), hash);
+  }
+  for (const auto& specialization : specializations) {
+    hash = hashValue(hash, specialization.stage);
+    hash = hashVector(hash, specialization.entries);
+    hash = hashVector(hash, specialization.data);
+  }
+  hash = hashVector(hash, vertexBindings);
+  hash = hashVector(hash, vertexAttributes);
+
+  // fixed function state field by field, the structs have padding and pointers
+  hash = hashValue(hash, state.inputAssemblyInfo.flags);
+  hash = hashValue(hash, state.inputAssemblyInfo.topology);
+  hash = hashValue(hash, state.inputAssemblyInfo.primitiveRestartEnable);
+  hash = hashValue(hash, state.rasterizationInfo.flags);
+  hash = hashValue(hash, state.rasterizationInfo.polygonMode);
+  hash = hashValue(hash, state.rasterizationInfo.cullMode);
+  hash = hashValue(hash, state.rasterizationInfo.frontFace);
+  hash = hashValue(hash, state.rasterizationInfo.depthBiasEnable);
+  hash = hashValue(hash, state.rasterizationInfo.lineWidth);
+  hash = hashValue(hash, state.multisampleInfo.rasterizationSamples);
+  hash = hashValue(hash, state.multisampleInfo.sampleShadingEnable);
+  hash = hashValue(hash, state.multisampleInfo.minSampleShading);
+  hash = hashValue(hash, state.multisampleInfo.alphaToCoverageEnable);
+  hash = hashValue(hash, state.multisampleInfo.alphaToOneEnable);
+  hash = hashValue(hash, state.depthStencilInfo.depthTestEnable);
+  hash = hashValue(hash, state.depthStencilInfo.depthWriteEnable);
+  hash = hashValue(hash, state.depthStencilInfo.depthCompareOp);
+  hash = hashValue(hash, state.colorBlendAttachment);
+  hash = hashValue(hash, dynamicState.state1);
+  hash = hashValue(hash, dynamicState.state2);
+  hash = hashValue(hash, dynamicState.blend);
+  return hash;
+}
+
+/**
+ * @brief copy of the description with its dynamic state reset to fixed
+ *        values, leaving only what the pipeline bakes in
+ * 
+ */
+PipelineDescription PipelineDescription::baked() const {
+  PipelineDescription state = *this;
+  if (dynamicState.state1) {
+    state.inputAssemblyInfo.topology = topologyClass(inputAssemblyInfo.topology);
+    state.rasterizationInfo.cullMode = VK_CULL_MODE_NONE;
+    state.rasterizationInfo.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+    state.depthStencilInfo.depthTestEnable = VK_FALSE;
+    state.depthStencilInfo.depthWriteEnable = VK_FALSE;
+    state.depthStencilInfo.depthCompareOp = VK_COMPARE_OP_NEVER;
+  }
+  if (dynamicState.state2) {
+    state.inputAssemblyInfo.primitiveRestartEnable = VK_FALSE;
+    state.rasterizationInfo.depthBiasEnable = VK_FALSE;
+  }
+  if (dynamicState.blend) {
+    state.colorBlendAttachment = {};
+  }
+  return state;
+}
+
+/**
+ * @brief copy the current settings into a description that can be built later
+ * 
+ * @param renderPass : render pass the use in the pipeline
+ * @return PipelineDescription : the pipeline state
+ */
+PipelineDescription PipelineBuilder::describe(VkRenderPass renderPass) const {
+  PipelineDescription description;
+  description.layout = layout;
+  description.renderPass = renderPass;
+  description.shaderStages = shaderStages;
+  description.specializations = specializations;
+  description.vertexBindings = vertexBindings;
+  description.vertexAttributes = vertexAttributes;
+  description.inputAssemblyInfo = inputAssemblyInfo;
+  description.rasterizationInfo = rasterizationInfo;
+  description.multisampleInfo = mutlisampleInfo;
+  description.depthStencilInfo = depthStencilInfo;
+  description.colorBlendAttachment = colorBlendAttachment;
+  description.dynamicState = vk::extendedDynamicState;
+  return description;
+}
+
+/**
+ * @brief copy the current settings into a description for dynamic rendering
+ * 
+ * @param colorFormats : formats of the color attachments rendered to
+ * @param depthFormat : format of the depth attachment, or VK_FORMAT_UNDEFINED
+ * @return PipelineDescription : the pipeline state
+ */
+PipelineDescription PipelineBuilder::describe(const std::vector<VkFormat>& colorFormats, VkFormat depthFormat) const {
+  PipelineDescription description = describe(VK_NULL_HANDLE);
+  description.colorFormats = colorFormats;
+  description.depthFormat = depthFormat;
+  return description;
+}
+
+/**
+ * @brief build the graphics pipeline with the included settings
+ * 
+ * @param renderPass : render pass the use in the pipeline
+ * @param cache : pipeline cache to compile through, or VK_NULL_HANDLE
+ * @return VkPipeline : the built pipeline
+ */
+VkPipeline PipelineBuilder::build(VkRenderPass renderPass, VkPipelineCache cache) const {
+  return describe(renderPass).build(cache);
+}
+
+/**
+ * @brief the state to record after binding a pipeline built from these
+ *        settings, see RenderState
+ * 
+ */
+RenderState PipelineBuilder::getRenderState() const {
+  RenderState state {};
+  state.topology = inputAssemblyInfo.topology;
+  state.primitiveRestartEnable = inputAssemblyInfo.primitiveRestartEnable;
+  state.cullMode = rasterizationInfo.cullMode;
+  state.frontFace = rasterizationInfo.frontFace;
+  state.depthBiasEnable = rasterizationInfo.depthBiasEnable;
+  state.depthTestEnable = depthStencilInfo.depthTestEnable;
+  state.depthWriteEnable = depthStencilInfo.depthWriteEnable;
+  state.depthCompareOp = depthStencilInfo.depthCompareOp;
+  state.colorBlendAttachment = colorBlendAttachment;
+  return state;
+}
+
 /**
  * @brief attach shaders to the pipeline
  * 
@@ -115,10 +384,8 @@ void PipelineBuilder::addShaders(VkShaderModule vertShader, VkShaderModule fragS
 }
 
 void PipelineBuilder::setVertexInputStateEmpty() {
-  vertexInputInfo.vertexBindingDescriptionCount = 0;
-  vertexInputInfo.pVertexBindingDescriptions = nullptr;
-  vertexInputInfo.vertexAttributeDescriptionCount = 0;
-  vertexInputInfo.pVertexAttributeDescriptions = nullptr;
+  vertexBindings.clear();
+  vertexAttributes.clear();
 }
 
 /**
@@ -131,10 +398,8 @@ void PipelineBuilder::setVertexInputState(
     const std::vector<VkVertexInputBindingDescription> &vertexBindingDescriptions,
     const std::vector<VkVertexInputAttributeDescription> &vertexAttributeDescriptions
 ) {
-    vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(vertexBindingDescriptions.size());
-    vertexInputInfo.pVertexBindingDescriptions = vertexBindingDescriptions.data();
-    vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(vertexAttributeDescriptions.size());
-    vertexInputInfo.pVertexAttributeDescriptions = vertexAttributeDescriptions.data();
+    vertexBindings = vertexBindingDescriptions;
+    vertexAttributes = vertexAttributeDescriptions;
 }
 
 /**
@@ -213,7 +478,8 @@ void PipelineBuilder::setDepthStencilState(
     VkBool32 depthWriteEnable,
     VkCompareOp depthCompareOp
 ) {
-  depthStencilInfo.depthBoundsTestEnable = depthWriteEnable;
+  depthStencilInfo.depthTestEnable = depthTestEnable;
+  depthStencilInfo.depthBoundsTestEnable = VK_FALSE;
   depthStencilInfo.depthWriteEnable = depthWriteEnable;
   depthStencilInfo.depthCompareOp = depthCompareOp;
   depthStencilInfo.back.compareOp = VK_COMPARE_OP_ALWAYS;
@@ -279,6 +545,21 @@ void PipelineBuilder::enableAlphaBlend() {
   colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
 }
 
+/**
+ * @brief find the specialization constants of a stage, adding them if the
+ *        stage has none yet
+ * 
+ */
+SpecializationConstants& PipelineBuilder::getSpecialization(const VkShaderStageFlagBits stage) {
+  for (auto& specialization : specializations) {
+    if (specialization.stage == stage) {
+      return specialization;
+    }
+  }
+  specializations.push_back({stage, {}, {}});
+  return specializations.back();
+}
+
 /**
  * @brief stores the binary data of a provided file
  * 
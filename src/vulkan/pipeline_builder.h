@@ -1,22 +1,142 @@
 #pragma once
 
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
 #include <vector>
 #include <string>
 
+#include "../util/types.h"
+
 #include <vulkan/vulkan_core.h>
 
 namespace mb {
 
+/**
+ * @brief specialization constant values of one shader stage
+ * 
+ */
+struct SpecializationConstants {
+  VkShaderStageFlagBits stage;
+  std::vector<VkSpecializationMapEntry> entries;
+  std::vector<uint8_t> data;
+
+  /**
+   * @brief set the value of a constant_id, bools are stored as VkBool32 as
+   *        SPIR-V expects
+   * 
+   * @param constantID : constant_id declared in the shader
+   * @param value : 32 or 64 bit scalar, or bool
+   */
+  template<typename T>
+  void set(const uint32_t constantID, const T& value) {
+    if constexpr (std::is_same_v<T, bool>) {
+      set<VkBool32>(constantID, value ? VK_TRUE : VK_FALSE);
+    }
+    else {
+      static_assert(std::is_arithmetic_v<T> && (sizeof(T) == 4 || sizeof(T) == 8), 
+        "specialization constants must be bool or 32/64 bit scalars");
+
+      for (const auto& entry : entries) {
+        if (entry.constantID == constantID && entry.size == sizeof(T)) {
+          std::memcpy(data.data() + entry.offset, &value, sizeof(T));
+          return;
+        }
+      }
+      // a redeclared constant of another size is appended, the last entry wins
+      std::erase_if(entries, [constantID](const VkSpecializationMapEntry& entry) {return entry.constantID == constantID;});
+
+      VkSpecializationMapEntry entry {};
+      entry.constantID = constantID;
+      entry.offset = static_cast<uint32_t>(data.size());
+      entry.size = sizeof(T);
+      entries.push_back(entry);
+      data.resize(data.size() + sizeof(T));
+      std::memcpy(data.data() + entry.offset, &value, sizeof(T));
+    }
+  }
+};
+
+/**
+ * @brief fixed function state a draw records after binding its pipeline,
+ *        on devices with extended dynamic state
+ * 
+ * Pipelines that differ only in this state collapse into one compiled
+ * pipeline. Groups the device cannot set dynamically stay baked into the
+ * pipeline, and are not recorded.
+ */
+struct RenderState {
+  VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+  VkBool32 primitiveRestartEnable = VK_FALSE;
+  VkCullModeFlags cullMode = VK_CULL_MODE_NONE;
+  VkFrontFace frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+  VkBool32 depthBiasEnable = VK_FALSE;
+  VkBool32 depthTestEnable = VK_FALSE;
+  VkBool32 depthWriteEnable = VK_FALSE;
+  VkCompareOp depthCompareOp = VK_COMPARE_OP_NEVER;
+  VkPipelineColorBlendAttachmentState colorBlendAttachment {};
+
+  void record(VkCommandBuffer buffer) const;
+};
+
+/**
+ * @brief complete state of a graphics pipeline, owning everything it points
+ *        to so it can be compiled on another thread
+ * 
+ * Shader modules, the layout and the render pass are referenced and must
+ * stay alive until the build has finished. Without a render pass the
+ * pipeline is built for dynamic rendering against the attachment formats.
+ */
+struct PipelineDescription {
+  VkPipelineLayout layout = VK_NULL_HANDLE;
+  VkRenderPass renderPass = VK_NULL_HANDLE;
+  std::vector<VkFormat> colorFormats;
+  VkFormat depthFormat = VK_FORMAT_UNDEFINED;
+  std::vector<VkPipelineShaderStageCreateInfo> shaderStages;
+  std::vector<SpecializationConstants> specializations;
+  std::vector<VkVertexInputBindingDescription> vertexBindings;
+  std::vector<VkVertexInputAttributeDescription> vertexAttributes;
+  VkPipelineInputAssemblyStateCreateInfo inputAssemblyInfo;
+  VkPipelineRasterizationStateCreateInfo rasterizationInfo;
+  VkPipelineMultisampleStateCreateInfo multisampleInfo;
+  VkPipelineDepthStencilStateCreateInfo depthStencilInfo;
+  VkPipelineColorBlendAttachmentState colorBlendAttachment;
+  // state left out of the pipeline, captured from the device when described
+  ExtendedDynamicState dynamicState;
+
+  VkPipeline build(VkPipelineCache cache = VK_NULL_HANDLE) const;
+  uint64_t hash() const;
+
+private:
+  PipelineDescription baked() const;
+};
+
 class PipelineBuilder {
 public:
   PipelineBuilder();
   ~PipelineBuilder();
 
   void clear();
-  VkPipeline build(VkRenderPass renderPass);
+  PipelineDescription describe(VkRenderPass renderPass) const;
+  PipelineDescription describe(const std::vector<VkFormat>& colorFormats, VkFormat depthFormat = VK_FORMAT_UNDEFINED) const;
+  VkPipeline build(VkRenderPass renderPass, VkPipelineCache cache = VK_NULL_HANDLE) const;
+  RenderState getRenderState() const;
 
   VkShaderModule static createShader(std::string shaderFilePath);
   void addShaders(VkShaderModule vertShader, VkShaderModule fragShader);
+
+  /**
+   * @brief specialize a constant_id of a shader stage, letting the driver
+   *        fold branches and unroll loops on it
+   * 
+   * @param stage : stage whose shader declares the constant
+   * @param constantID : constant_id declared in the shader
+   * @param value : 32 or 64 bit scalar, or bool
+   */
+  template<typename T>
+  void setSpecializationConstant(const VkShaderStageFlagBits stage, const uint32_t constantID, const T& value) {
+    getSpecialization(stage).set(constantID, value);
+  }
   void setVertexInputStateEmpty();
   void setVertexInputState(
       const std::vector<VkVertexInputBindingDescription> &vertexBindingDescriptions,
@@ -54,7 +174,9 @@ private:
 
   // structs for pipeline creation
   std::vector<VkPipelineShaderStageCreateInfo> shaderStages;
-  VkPipelineVertexInputStateCreateInfo vertexInputInfo;
+  std::vector<SpecializationConstants> specializations;
+  std::vector<VkVertexInputBindingDescription> vertexBindings;
+  std::vector<VkVertexInputAttributeDescription> vertexAttributes;
   VkPipelineInputAssemblyStateCreateInfo inputAssemblyInfo;
   VkPipelineRasterizationStateCreateInfo rasterizationInfo;
   VkPipelineMultisampleStateCreateInfo mutlisampleInfo;
@@ -62,6 +184,7 @@ private:
   VkPipelineColorBlendAttachmentState colorBlendAttachment;
 
   // helper functions
+  SpecializationConstants& getSpecialization(const VkShaderStageFlagBits stage);
   std::vector<char> static readFile(const std::string& filename);
   VkShaderModule static createShaderModule(const std::vector<char>& code);
 };
@@ -0,0 +1,143 @@
+#include "pipeline_cache.h"
+#include "vk.h"
+
+#include "../util/hash.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+namespace mb {
+
+/**
+ * @brief create the pipeline cache, seeded from a file when it was written
+ *        by the same device and driver
+ * 
+ * @param _filePath : file the cache is loaded from and saved to
+ */
+PipelineCache::PipelineCache(const std::string& _filePath) : filePath(_filePath) {
+  vkGetPhysicalDeviceProperties(vk::physicalDevice, &properties);
+
+  const std::vector<char> data = load();
+
+  VkPipelineCacheCreateInfo cacheInfo {};
+  cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+  cacheInfo.initialDataSize = data.size();
+  cacheInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+  if (vkCreatePipelineCache(vk::device, &cacheInfo, nullptr, &cache) != VK_SUCCESS) {
+    // the driver rejected the data, start from an empty cache
+    cacheInfo.initialDataSize = 0;
+    cacheInfo.pInitialData = nullptr;
+    if (vkCreatePipelineCache(vk::device, &cacheInfo, nullptr, &cache) != VK_SUCCESS) {
+      throw std::runtime_error("[ERROR]: failed to create pipeline cache");
+    }
+  }
+}
+
+PipelineCache::~PipelineCache() {
+  vkDestroyPipelineCache(vk::device, cache, nullptr);
+}
+
+/**
+ * @brief write the cache to disk, through a temporary file so an interrupted
+ *        save never leaves a truncated cache behind
+ * 
+ */
+void PipelineCache::save() {
+  size_t size = 0;
+  if (vkGetPipelineCacheData(vk::device, cache, &size, nullptr) != VK_SUCCESS || size == 0) {
+    return;
+  }
+  std::vector<char> data(size);
+  if (vkGetPipelineCacheData(vk::device, cache, &size, data.data()) != VK_SUCCESS) {
+    return;
+  }
+  data.resize(size);
+
+  const FileHeader header = makeHeader(data);
+  const std::string tempPath = filePath + ".tmp";
+  {
+    std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+      std::cerr << "[WARNING]: failed to write pipeline cache " << tempPath << "\n";
+      return;
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(data.data(), data.size());
+    if (!file) {
+      std::cerr << "[WARNING]: failed to write pipeline cache " << tempPath << "\n";
+      return;
+    }
+  }
+
+  std::error_code error;
+  std::filesystem::rename(tempPath, filePath, error);
+  if (error) {
+    std::cerr << "[WARNING]: failed to replace pipeline cache " << filePath << ": " << error.message() << "\n";
+    std::filesystem::remove(tempPath, error);
+  }
+}
+
+/**
+ * @brief read the cache file and validate it against the current device
+ * 
+ * @return std::vector<char> : driver cache data, empty if the file is
+ *                             missing, stale or corrupt
+ */
+std::vector<char> PipelineCache::load() {
+  std::ifstream file(filePath, std::ios::binary | std::ios::ate);
+  if (!file.is_open()) {
+    return {};
+  }
+
+  const std::streamsize fileSize = file.tellg();
+  FileHeader header {};
+  if (fileSize < static_cast<std::streamsize>(sizeof(header))) {
+    std::cout << "[INFO]: discarding truncated pipeline cache " << filePath << "\n";
+    return {};
+  }
+  file.seekg(0);
+  file.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+  if (header.magic != FILE_MAGIC || header.version != FILE_VERSION) {
+    std::cout << "[INFO]: discarding unrecognized pipeline cache " << filePath << "\n";
+    return {};
+  }
+  if (header.vendorID != properties.vendorID || header.deviceID != properties.deviceID 
+      || header.driverVersion != properties.driverVersion 
+      || std::memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+    std::cout << "[INFO]: discarding pipeline cache written by another device or driver\n";
+    return {};
+  }
+  if (header.dataSize != static_cast<uint64_t>(fileSize) - sizeof(header)) {
+    std::cout << "[INFO]: discarding truncated pipeline cache " << filePath << "\n";
+    return {};
+  }
+
+  std::vector<char> data(header.dataSize);
+  file.read(data.data(), data.size());
+  if (!file || fnv1a(data.data(), data.size()) != header.checksum) {
+    std::cout << "[INFO]: discarding corrupt pipeline cache " << filePath << "\n";
+    return {};
+  }
+
+  return data;
+}
+
+PipelineCache::FileHeader PipelineCache::makeHeader(const std::vector<char>& data) const {
+  FileHeader header {};
+  header.magic = FILE_MAGIC;
+  header.version = FILE_VERSION;
+  header.vendorID = properties.vendorID;
+  header.deviceID = properties.deviceID;
+  header.driverVersion = properties.driverVersion;
+  std::memcpy(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE);
+  header.dataSize = data.size();
+  header.checksum = fnv1a(data.data(), data.size());
+  return header;
+}
+
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan_core.h>
+
+namespace mb {
+
+/**
+ * @brief engine wide pipeline cache persisted between launches
+ * 
+ * The file starts with a header identifying the device and driver that
+ * wrote it, followed by the data returned by vkGetPipelineCacheData. Files
+ * written by another device or driver, or that fail the checksum, are
+ * ignored and replaced on the next save.
+ */
+class PipelineCache {
+public:
+  PipelineCache(const std::string& _filePath);
+  ~PipelineCache();
+
+  PipelineCache (const PipelineCache&) = delete;
+  PipelineCache& operator= (const PipelineCache&) = delete;
+
+  void save();
+
+  VkPipelineCache get() const {return cache;}
+
+private:
+  // header of the cache file, written in host byte order
+  struct FileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t vendorID;
+    uint32_t deviceID;
+    uint32_t driverVersion;
+    uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+    uint64_t dataSize;
+    uint64_t checksum;
+  };
+
+  static constexpr uint32_t FILE_MAGIC = 0x4350424d; // "MBPC"
+  static constexpr uint32_t FILE_VERSION = 1;
+
+  std::string filePath;
+  VkPipelineCache cache = VK_NULL_HANDLE;
+  VkPhysicalDeviceProperties properties;
+
+  std::vector<char> load();
+  FileHeader makeHeader(const std::vector<char>& data) const;
+};
+
+}
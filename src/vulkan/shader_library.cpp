@@ -0,0 +1,99 @@
+#include "shader_library.h"
+#include "vk.h"
+#include "embedded_shaders.h"
+
+#include "../util/hash.h"
+#include "../util/mapped_file.h"
+#include "../util/profiler.h"
+
+#include <filesystem>
+#include <stdexcept>
+
+namespace mb {
+
+// first word of every SPIR-V module
+static constexpr uint32_t SPIRV_MAGIC = 0x07230203;
+
+ShaderLibrary::~ShaderLibrary() {
+  for (const auto& [hash, module] : modules) {
+    vkDestroyShaderModule(vk::device, module, nullptr);
+  }
+}
+
+/**
+ * @brief get the module of a SPIR-V file, mapping and creating it only if
+ *        neither the path nor its contents were loaded before
+ * 
+ * Shaders compiled into the executable are found by file name and used
+ * without touching the file system.
+ * 
+ * @param filePath : path to the SPIR-V file
+ * @return VkShaderModule : module owned by the library
+ */
+VkShaderModule ShaderLibrary::load(const std::string& filePath) {
+  MB_PROFILE_ZONE("ShaderLibrary::load");
+
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = loadedPaths.find(filePath);
+  if (it != loadedPaths.end()) {
+    return it->second;
+  }
+
+  const std::string fileName = std::filesystem::path(filePath).filename().string();
+  if (const EmbeddedShader* shader = EmbeddedShaders::find(fileName)) {
+    VkShaderModule module = createLocked(shader->code, shader->size);
+    loadedPaths[filePath] = module;
+    return module;
+  }
+
+  // mappings are page aligned, so the words can be read in place
+  MappedFile file(filePath);
+  VkShaderModule module = createLocked(static_cast<const uint32_t*>(file.data()), file.size());
+  loadedPaths[filePath] = module;
+  return module;
+}
+
+/**
+ * @brief get the module of SPIR-V in memory, creating it only if the same
+ *        code was not loaded before
+ * 
+ * @param code : SPIR-V words, aligned to 4 bytes
+ * @param size : size of the code in bytes
+ * @return VkShaderModule : module owned by the library
+ */
+VkShaderModule ShaderLibrary::create(const uint32_t* code, const size_t size) {
+  std::lock_guard<std::mutex> lock(mutex);
+  return createLocked(code, size);
+}
+
+size_t ShaderLibrary::getModuleCount() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return modules.size();
+}
+
+VkShaderModule ShaderLibrary::createLocked(const uint32_t* code, const size_t size) {
+  if (size < sizeof(uint32_t) || size % sizeof(uint32_t) != 0 || code[0] != SPIRV_MAGIC) {
+    throw std::runtime_error("[ERROR]: shader code is not SPIR-V");
+  }
+
+  const uint64_t key = fnv1a(code, size);
+  auto it = modules.find(key);
+  if (it != modules.end()) {
+    return it->second;
+  }
+
+  VkShaderModuleCreateInfo moduleInfo {};
+  moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+  moduleInfo.codeSize = size;
+  moduleInfo.pCode = code;
+
+  VkShaderModule module;
+  if (vkCreateShaderModule(vk::device, &moduleInfo, nullptr, &module) != VK_SUCCESS) {
+    throw std::runtime_error("[ERROR]: Failed to create shader module");
+  }
+
+  modules[key] = module;
+  return module;
+}
+
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <vulkan/vulkan_core.h>
+
+namespace mb {
+
+/**
+ * @brief owns every shader module of the engine, keyed by a hash of the
+ *        SPIR-V so pipelines sharing a shader share its module
+ * 
+ * Files are memory mapped and handed to the driver without a copy, a path
+ * is only read the first time it is loaded. Modules live until the library
+ * is destroyed, after every pipeline using them.
+ */
+class ShaderLibrary {
+public:
+  ShaderLibrary() {}
+  ~ShaderLibrary();
+
+  ShaderLibrary (const ShaderLibrary&) = delete;
+  ShaderLibrary& operator= (const ShaderLibrary&) = delete;
+
+  // may be called from any thread
+  VkShaderModule load(const std::string& filePath);
+  VkShaderModule create(const uint32_t* code, const size_t size);
+
+  size_t getModuleCount();
+
+private:
+  std::mutex mutex;
+  std::unordered_map<uint64_t, VkShaderModule> modules;
+  std::unordered_map<std::string, VkShaderModule> loadedPaths;
+
+  VkShaderModule createLocked(const uint32_t* code, const size_t size);
+};
+
+}
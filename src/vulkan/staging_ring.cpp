@@ -0,0 +1,78 @@
+#include "staging_ring.h"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace mb {
+
+StagingRing::StagingRing(const VkDeviceSize _capacity) : capacity(_capacity) {
+  buffer.allocateBuffer(
+    VK_BUFFER_USAGE_TRANSFER_SRC_BIT, 
+    VMA_MEMORY_USAGE_AUTO, 
+    VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT, 
+    capacity
+  );
+  if (!buffer.mapped) {
+    throw std::runtime_error("[ERROR]: failed to map staging ring");
+  }
+}
+
+/**
+ * @brief bump allocate a region, wrapping to the start of the ring when the
+ *        end is reached
+ * 
+ * @param size : size of the region in bytes
+ * @param alignment : required alignment of the region offset
+ * @return std::optional<StagingAllocation> : empty if the ring is too full
+ */
+std::optional<StagingAllocation> StagingRing::allocate(const VkDeviceSize size, const VkDeviceSize alignment) {
+  if (size > capacity) {
+    return std::nullopt;
+  }
+  if (isEmpty()) {
+    head = 0;
+    tail = 0;
+  }
+
+  VkDeviceSize offset = (head + alignment - 1) / alignment * alignment;
+  if (isEmpty() || head > tail) {
+    // free space is [head, capacity) followed by [0, tail)
+    if (offset + size > capacity) {
+      if (size > tail) return std::nullopt;
+      offset = 0;
+    }
+  }
+  else if (offset + size > tail) {
+    // wrapped, free space is [head, tail)
+    return std::nullopt;
+  }
+
+  head = offset + size;
+  pending = true;
+  return StagingAllocation{buffer.buffer, offset, static_cast<char*>(buffer.mapped) + offset};
+}
+
+/**
+ * @brief tag every allocation since the last release with the timeline value
+ *        of the submission reading them
+ * 
+ */
+void StagingRing::release(const uint64_t timelineValue) {
+  if (!pending) return;
+  regions.push_back({head, timelineValue});
+  pending = false;
+}
+
+/**
+ * @brief free the regions of every submission that has completed
+ * 
+ * @param completedValue : timeline value the GPU has reached
+ */
+void StagingRing::reclaim(const uint64_t completedValue) {
+  while (!regions.empty() && regions.front().timelineValue <= completedValue) {
+    tail = regions.front().end;
+    regions.pop_front();
+  }
+}
+
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "buffer.h"
+
+#include <cstdint>
+#include <deque>
+#include <optional>
+
+#include <vulkan/vulkan_core.h>
+
+namespace mb {
+
+/**
+ * @brief region of the staging ring handed out for one upload
+ * 
+ */
+struct StagingAllocation {
+  VkBuffer buffer;
+  VkDeviceSize offset;
+  void* data;
+};
+
+/**
+ * @brief persistently mapped host buffer that staging memory is bump
+ *        allocated from, regions are recycled once the submission that
+ *        read them reaches its timeline value
+ * 
+ */
+class StagingRing {
+public:
+  StagingRing(const VkDeviceSize _capacity);
+
+  StagingRing (const StagingRing&) = delete;
+  StagingRing& operator= (const StagingRing&) = delete;
+
+  std::optional<StagingAllocation> allocate(const VkDeviceSize size, const VkDeviceSize alignment = 16);
+  void flush(const StagingAllocation& allocation, const VkDeviceSize size) {buffer.flush(allocation.offset, size);}
+  void release(const uint64_t timelineValue);
+  void reclaim(const uint64_t completedValue);
+
+  bool hasPending() const {return pending;}
+  VkDeviceSize getCapacity() const {return capacity;}
+
+private:
+  // end of the memory used by a submission
+  struct Region {
+    VkDeviceSize end;
+    uint64_t timelineValue;
+  };
+
+  Buffer buffer;
+  VkDeviceSize capacity;
+  VkDeviceSize head = 0;
+  VkDeviceSize tail = 0;
+  // allocations made since the last release
+  bool pending = false;
+  std::deque<Region> regions;
+
+  bool isEmpty() const {return regions.empty() && !pending;}
+};
+
+}
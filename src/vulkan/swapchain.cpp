@@ -12,20 +12,23 @@
 namespace mb {
 
 Swapchain::Swapchain(const VkInstance _instance, VkDevice _device, VkPhysicalDevice _physicalDevice, 
-    QueueFamilyIndices _indices, const VkSurfaceKHR _surface, SDL_Window* _window) :
-instance(_instance), device(_device), physicalDevice(_physicalDevice), queueIndices(_indices), surface(_surface), window(_window) {
+    QueueFamilyIndices _indices, const VkSurfaceKHR _surface, SDL_Window* _window, const bool _useRenderPass) :
+instance(_instance), device(_device), physicalDevice(_physicalDevice), queueIndices(_indices), surface(_surface), window(_window), 
+useRenderPass(_useRenderPass) {
   getSwapchainDetails();
   chooseSwapchainSettings();
   createSwapchain();
   createImages();
   createImageViews();
-  createRenderPass();
-  createFramebuffers();
+  if (useRenderPass) {
+    createRenderPass();
+    createFramebuffers();
+  }
 }
 
 Swapchain::~Swapchain() {
   cleanup();
-  vkDestroyRenderPass(device, renderPass, nullptr);
+  if (renderPass) vkDestroyRenderPass(device, renderPass, nullptr);
 }
 
 /**
@@ -42,7 +45,9 @@ void Swapchain::recreate() {
   createSwapchain();
   createImages();
   createImageViews();
-  createFramebuffers();
+  if (useRenderPass) {
+    createFramebuffers();
+  }
 }
 
 /**
@@ -296,6 +301,8 @@ void Swapchain::cleanup() {
   for (auto& view : imageViews) {
     vkDestroyImageView(device, view, nullptr);
   }
+  framebuffers.clear();
+  imageViews.clear();
   vkDestroySwapchainKHR(device, swapchain, nullptr);
 }
 
@@ -17,7 +17,7 @@ namespace mb {
 class Swapchain {
 public:
   Swapchain(const VkInstance _instance, VkDevice _device, VkPhysicalDevice _physicalDevice, 
-    QueueFamilyIndices _indices, const VkSurfaceKHR _surface, SDL_Window* _window);
+    QueueFamilyIndices _indices, const VkSurfaceKHR _surface, SDL_Window* _window, const bool _useRenderPass = true);
   ~Swapchain();
 
   VkSwapchainKHR get() {return swapchain;}
@@ -27,7 +27,8 @@ public:
   // vulkan handles
   std::vector<VkImage> images;
   std::vector<VkImageView> imageViews;
-  VkRenderPass renderPass;
+  // only created when not rendering dynamically
+  VkRenderPass renderPass = VK_NULL_HANDLE;
   std::vector<VkFramebuffer> framebuffers;
 
   // chosen swapchain settings
@@ -42,6 +43,7 @@ private:
   const VkSurfaceKHR surface;
   QueueFamilyIndices queueIndices;
   SDL_Window* window;
+  const bool useRenderPass;
 
   // handle for swapchain
   VkSwapchainKHR swapchain;
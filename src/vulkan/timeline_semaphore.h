@@ -0,0 +1,107 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+
+#include "vk.h"
+
+namespace mb {
+
+/**
+ * @brief monotonically increasing GPU counter, one per queue, that every
+ *        submission to the queue signals with the next value
+ * 
+ */
+class TimelineSemaphore {
+public:
+  TimelineSemaphore(uint64_t initialValue = 0) : signaledValue(initialValue), completedValue(initialValue) {
+    VkSemaphoreTypeCreateInfo typeInfo {};
+    typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    typeInfo.initialValue = initialValue;
+
+    VkSemaphoreCreateInfo semaphoreInfo {};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &typeInfo;
+    if (vkCreateSemaphore(vk::device, &semaphoreInfo, nullptr, &semaphore) != VK_SUCCESS) {
+      throw std::runtime_error("[ERROR]: failed to create timeline semaphore");
+    }
+  }
+
+  ~TimelineSemaphore() {
+    clear();
+  }
+
+  void clear() {
+    if (semaphore) {
+      vkDestroySemaphore(vk::device, semaphore, nullptr);
+      semaphore = VK_NULL_HANDLE;
+    }
+  }
+
+  VkSemaphore& get() {return semaphore;}
+
+  /**
+   * @brief reserve the value the next queue submission will signal
+   * 
+   * @return uint64_t : value to pass in VkTimelineSemaphoreSubmitInfo
+   */
+  uint64_t next() {return ++signaledValue;}
+
+  /**
+   * @brief the most recent value handed out to a submission
+   * 
+   */
+  uint64_t lastSignaled() const {return signaledValue;}
+
+  /**
+   * @brief query the value the GPU has reached
+   * 
+   */
+  uint64_t completed() {
+    uint64_t value;
+    vkGetSemaphoreCounterValue(vk::device, semaphore, &value);
+    completedValue = value;
+    return value;
+  }
+
+  /**
+   * @brief checks if the GPU has finished the submission that signals value,
+   *        only querying the device when the cached value is behind
+   * 
+   */
+  bool isComplete(const uint64_t value) {
+    return value <= completedValue || value <= completed();
+  }
+
+  /**
+   * @brief block the calling thread until the GPU reaches value
+   * 
+   * @param value : timeline value to wait for
+   * @param timeout : timeout in nanoseconds
+   * @return true if the value was reached before the timeout
+   */
+  bool wait(const uint64_t value, const uint64_t timeout = UINT64_MAX) {
+    if (value <= completedValue) return true;
+
+    VkSemaphoreWaitInfo waitInfo {};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &semaphore;
+    waitInfo.pValues = &value;
+    if (vkWaitSemaphores(vk::device, &waitInfo, timeout) != VK_SUCCESS) {
+      return false;
+    }
+
+    completed();
+    return true;
+  }
+
+private:
+  VkSemaphore semaphore = VK_NULL_HANDLE;
+  std::atomic<uint64_t> signaledValue;
+  std::atomic<uint64_t> completedValue;
+};
+
+}
@@ -0,0 +1,487 @@
+#include "upload_queue.h"
+#include "vk.h"
+
+#include "../util/profiler.h"
+
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+namespace mb {
+
+/**
+ * @brief create an upload queue
+ * 
+ * @param _queue : queue the batches are submitted to
+ * @param _queueFamily : family of the upload queue
+ * @param _timeline : timeline semaphore of the upload queue
+ * @param _dstQueueFamily : family of the queue that uses the uploaded resources
+ * @param stagingCapacity : size of the staging ring in bytes
+ */
+UploadQueue::UploadQueue(VkQueue _queue, const uint32_t _queueFamily, TimelineSemaphore& _timeline, const uint32_t _dstQueueFamily, const VkDeviceSize stagingCapacity) :
+queue(_queue), queueFamily(_queueFamily), timeline(_timeline), dstQueueFamily(_dstQueueFamily), ring(stagingCapacity) {}
+
+UploadQueue::~UploadQueue() {
+  waitIdle();
+}
+
+/**
+ * @brief record commands into the current batch
+ * 
+ * @param function : records the upload commands
+ * @return UploadTicket : completes when the batch finishes on the GPU
+ */
+UploadTicket UploadQueue::enqueue(std::function<void(VkCommandBuffer cmd)>&& function) {
+  auto lock = lockForRequest();
+  function(beginBatch());
+  return {currentBatch};
+}
+
+/**
+ * @brief copy data into a buffer through staging memory, the data is
+ *        copied before returning
+ * 
+ * @param dst : buffer to write, must have been created with TRANSFER_DST usage
+ * @param data : data to upload
+ * @param size : size of the data in bytes
+ * @param dstOffset : byte offset into the destination buffer
+ * @return UploadTicket : completes when the copy finishes on the GPU
+ */
+UploadTicket UploadQueue::uploadBuffer(VkBuffer dst, const void* data, const VkDeviceSize size, const VkDeviceSize dstOffset) {
+  return uploadBuffer(dst, size, [data, size](void* staging) {std::memcpy(staging, data, size);}, dstOffset);
+}
+
+/**
+ * @brief write a buffer through staging memory filled by the caller, so data
+ *        can be converted straight into staging instead of into a temporary
+ * 
+ * @param dst : buffer to write, must have been created with TRANSFER_DST usage
+ * @param size : size of the data in bytes
+ * @param writer : fills the size bytes of staging memory it is given
+ * @param dstOffset : byte offset into the destination buffer
+ * @return UploadTicket : completes when the copy finishes on the GPU
+ */
+UploadTicket UploadQueue::uploadBuffer(VkBuffer dst, const VkDeviceSize size, const StagingWriter& writer, const VkDeviceSize dstOffset) {
+  StagingReservation staging {};
+  UploadTicket ticket {};
+  {
+    auto lock = lockForRequest();
+    staging = reserve(lock, size);
+    VkCommandBuffer cmd = beginBatch();
+
+    VkBufferCopy region {};
+    region.srcOffset = staging.allocation.offset;
+    region.dstOffset = dstOffset;
+    region.size = size;
+    vkCmdCopyBuffer(cmd, staging.allocation.buffer, dst, 1, &region);
+
+    if (transfersOwnership()) {
+      VkBufferMemoryBarrier barrier {};
+      barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+      barrier.srcQueueFamilyIndex = queueFamily;
+      barrier.dstQueueFamilyIndex = dstQueueFamily;
+      barrier.buffer = dst;
+      barrier.offset = dstOffset;
+      barrier.size = size;
+
+      // release
+      barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+      barrier.dstAccessMask = 0;
+      vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+
+      // acquire, recorded by the consumer queue, which may also copy the buffer
+      barrier.srcAccessMask = 0;
+      barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+      recordingBufferAcquires.push_back(barrier);
+    }
+
+    pendingWrites++;
+    ticket = {currentBatch};
+  }
+
+  write(staging, size, writer);
+  return ticket;
+}
+
+/**
+ * @brief copy tightly packed pixels into mip 0 of an image and leave it ready
+ *        for shader reads
+ * 
+ * @param dst : image to write, must have been created with TRANSFER_DST usage
+ * @param data : pixel data
+ * @param size : size of the pixel data in bytes
+ * @param extent : dimensions of the image
+ * @return UploadTicket : completes when the copy finishes on the GPU
+ */
+UploadTicket UploadQueue::uploadImage(VkImage dst, const void* data, const VkDeviceSize size, const VkExtent3D extent) {
+  StagingReservation staging {};
+  UploadTicket ticket {};
+  {
+    auto lock = lockForRequest();
+    staging = reserve(lock, size);
+    VkCommandBuffer cmd = beginBatch();
+
+    VkImageMemoryBarrier barrier {};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = dst;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    VkBufferImageCopy region {};
+    region.bufferOffset = staging.allocation.offset;
+    region.bufferRowLength = 0;
+    region.bufferImageHeight = 0;
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel = 0;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = 1;
+    region.imageOffset = {0, 0, 0};
+    region.imageExtent = extent;
+    vkCmdCopyBufferToImage(cmd, staging.allocation.buffer, dst, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    if (transfersOwnership()) {
+      // release, the layout transition happens once across the release and acquire
+      barrier.srcQueueFamilyIndex = queueFamily;
+      barrier.dstQueueFamilyIndex = dstQueueFamily;
+      barrier.dstAccessMask = 0;
+      vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+      // acquire, recorded by the consumer queue
+      barrier.srcAccessMask = 0;
+      barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+      recordingImageAcquires.push_back(barrier);
+    }
+    else {
+      barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+      vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+    }
+
+    pendingWrites++;
+    ticket = {currentBatch};
+  }
+
+  write(staging, size, [data, size](void* memory) {std::memcpy(memory, data, size);});
+  return ticket;
+}
+
+/**
+ * @brief checks if the batch of a ticket has finished on the GPU
+ * 
+ */
+bool UploadQueue::isComplete(const UploadTicket ticket) {
+  std::lock_guard<std::mutex> lock(mutex);
+  retire();
+  return ticket.batch <= completedBatch;
+}
+
+/**
+ * @brief block until the batch of a ticket finishes on the GPU, without
+ *        submitting anything, so the owning thread must have flushed it
+ * 
+ */
+void UploadQueue::wait(const UploadTicket ticket) {
+  MB_PROFILE_ZONE("UploadQueue::wait");
+
+  uint64_t timelineValue = 0;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    retire();
+    if (ticket.batch <= completedBatch) return;
+    if (ticket.batch >= currentBatch) {
+      throw std::runtime_error("[ERROR]: waiting on an upload batch that was not flushed");
+    }
+    for (const auto& batch : inFlight) {
+      if (batch.id >= ticket.batch) {
+        timelineValue = batch.timelineValue;
+        break;
+      }
+    }
+  }
+
+  timeline.wait(timelineValue);
+}
+
+/**
+ * @brief submit the current batch, if any, with a single queue submission
+ * 
+ */
+void UploadQueue::flush() {
+  MB_PROFILE_ZONE("UploadQueue::flush");
+
+  std::unique_lock<std::mutex> lock(mutex);
+  submit(lock);
+}
+
+/**
+ * @brief submit the current batch once every write into it finished, called
+ *        by the owning thread with the queue locked
+ * 
+ * @param lock : lock of the queue mutex, released while writes finish
+ */
+void UploadQueue::submit(std::unique_lock<std::mutex>& lock) {
+  // the copies of the batch read staging memory other threads may still fill
+  flushing = true;
+  queueChanged.wait(lock, [this]() {return pendingWrites == 0;});
+  flushing = false;
+  queueChanged.notify_all();
+  retire();
+  if (!recordingCmd) return;
+
+  VkCommandBuffer cmd = recordingCmd->buffer;
+
+  // on a shared queue, make the copies visible to everything submitted afterwards
+  if (!transfersOwnership()) {
+    VkMemoryBarrier barrier {};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+    vkCmdPipelineBarrier(
+      cmd, 
+      VK_PIPELINE_STAGE_TRANSFER_BIT, 
+      VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, 
+      0, 1, &barrier, 0, nullptr, 0, nullptr
+    );
+  }
+
+  if (vkEndCommandBuffer(cmd) != VK_SUCCESS) {
+    throw std::runtime_error("[ERROR]: failed to end upload command buffer");
+  }
+
+  const uint64_t signalValue = timeline.next();
+  VkTimelineSemaphoreSubmitInfo timelineInfo {};
+  timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+  timelineInfo.signalSemaphoreValueCount = 1;
+  timelineInfo.pSignalSemaphoreValues = &signalValue;
+
+  VkSubmitInfo submitInfo {};
+  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submitInfo.pNext = &timelineInfo;
+  submitInfo.commandBufferCount = 1;
+  submitInfo.pCommandBuffers = &cmd;
+  submitInfo.signalSemaphoreCount = 1;
+  submitInfo.pSignalSemaphores = &timeline.get();
+
+  if (vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+    throw std::runtime_error("[ERROR]: failed to submit upload batch");
+  }
+
+  ring.release(signalValue);
+  inFlight.push_back({currentBatch, signalValue, std::move(recordingCmd), std::move(recordingStaging)});
+  recordingStaging.clear();
+  currentBatch++;
+
+  if (!recordingBufferAcquires.empty() || !recordingImageAcquires.empty()) {
+    pendingBufferAcquires.insert(pendingBufferAcquires.end(), recordingBufferAcquires.begin(), recordingBufferAcquires.end());
+    pendingImageAcquires.insert(pendingImageAcquires.end(), recordingImageAcquires.begin(), recordingImageAcquires.end());
+    recordingBufferAcquires.clear();
+    recordingImageAcquires.clear();
+    pendingAcquireValue = signalValue;
+  }
+  queueChanged.notify_all();
+}
+
+/**
+ * @brief record the acquire half of the ownership transfers of every
+ *        submitted batch into a command buffer of the consumer queue
+ * 
+ * @param cmd : command buffer of the consumer queue, outside of a render pass
+ * @return uint64_t : upload timeline value the submission of cmd must wait
+ *                    on before the acquire, 0 if nothing was recorded
+ */
+uint64_t UploadQueue::recordAcquireBarriers(VkCommandBuffer cmd) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (pendingBufferAcquires.empty() && pendingImageAcquires.empty()) {
+    return 0;
+  }
+
+  vkCmdPipelineBarrier(
+    cmd, 
+    VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 
+    VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, 
+    0, 
+    0, nullptr, 
+    static_cast<uint32_t>(pendingBufferAcquires.size()), pendingBufferAcquires.data(), 
+    static_cast<uint32_t>(pendingImageAcquires.size()), pendingImageAcquires.data()
+  );
+  pendingBufferAcquires.clear();
+  pendingImageAcquires.clear();
+
+  return pendingAcquireValue;
+}
+
+/**
+ * @brief submit everything recorded and wait for all batches to finish
+ * 
+ */
+void UploadQueue::waitIdle() {
+  flush();
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!inFlight.empty()) {
+      timeline.wait(inFlight.back().timelineValue);
+    }
+    retire();
+  }
+}
+
+/**
+ * @brief start recording a batch if none is open
+ * 
+ * @return VkCommandBuffer : command buffer of the current batch
+ */
+VkCommandBuffer UploadQueue::beginBatch() {
+  if (recordingCmd) {
+    return recordingCmd->buffer;
+  }
+
+  if (!freeCommands.empty()) {
+    recordingCmd = std::move(freeCommands.back());
+    freeCommands.pop_back();
+  }
+  else {
+    recordingCmd = std::make_unique<Command>(queueFamily);
+  }
+
+  VkCommandBufferBeginInfo beginInfo {};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  if (vkBeginCommandBuffer(recordingCmd->buffer, &beginInfo) != VK_SUCCESS) {
+    throw std::runtime_error("[ERROR]: failed to begin upload command buffer");
+  }
+
+  return recordingCmd->buffer;
+}
+
+/**
+ * @brief lock the queue to record a request, once no flush is waiting for
+ *        the writes of its batch
+ * 
+ */
+std::unique_lock<std::mutex> UploadQueue::lockForRequest() {
+  std::unique_lock<std::mutex> lock(mutex);
+  queueChanged.wait(lock, [this]() {return !flushing;});
+  return lock;
+}
+
+/**
+ * @brief reserve staging memory from the ring, waiting for submitted batches
+ *        to free space when it is full, called with the queue locked
+ * 
+ * Only the owning thread submits, so it flushes the recording batch when
+ * that is what fills the ring, other threads wait for the owner to. An
+ * upload larger than the whole ring gets a dedicated buffer that is freed
+ * with the batch.
+ * 
+ * @param lock : lock of the queue mutex, released while waiting
+ * @param size : size of the data in bytes
+ */
+UploadQueue::StagingReservation UploadQueue::reserve(std::unique_lock<std::mutex>& lock, const VkDeviceSize size) {
+  retire();
+  if (size > ring.getCapacity()) {
+    auto staging = createStagingBuffer(size);
+    const StagingReservation reservation {{staging->buffer, 0, staging->mapped}, staging.get()};
+    recordingStaging.push_back(std::move(staging));
+    return reservation;
+  }
+
+  std::optional<StagingAllocation> allocation;
+  while (!(allocation = ring.allocate(size))) {
+    MB_PROFILE_ZONE("UploadQueue::reserve wait");
+
+    if (std::this_thread::get_id() == owner && recordingCmd) {
+      submit(lock);
+    }
+    else if (!inFlight.empty()) {
+      const uint64_t timelineValue = inFlight.front().timelineValue;
+      lock.unlock();
+      timeline.wait(timelineValue);
+      lock.lock();
+    }
+    else {
+      // the ring is held by the recording batch, which only the owner submits
+      queueChanged.wait(lock);
+    }
+    queueChanged.wait(lock, [this]() {return !flushing;});
+    retire();
+  }
+  return {*allocation, nullptr};
+}
+
+/**
+ * @brief fill reserved staging memory without the queue locked, the batch
+ *        holding the copy is submitted once every write into it finished
+ * 
+ * @param staging : memory returned by reserve for a request already recorded
+ * @param size : size of the data in bytes
+ * @param writer : fills the size bytes of staging memory it is given
+ */
+void UploadQueue::write(const StagingReservation& staging, const VkDeviceSize size, const StagingWriter& writer) {
+  auto finish = [this]() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      pendingWrites--;
+    }
+    queueChanged.notify_all();
+  };
+
+  try {
+    writer(staging.allocation.data);
+    if (staging.dedicated) {
+      staging.dedicated->flush(0, size);
+    }
+    else {
+      ring.flush(staging.allocation, size);
+    }
+  }
+  catch (...) {
+    finish();
+    throw;
+  }
+  finish();
+}
+
+/**
+ * @brief create a persistently mapped host visible buffer
+ * 
+ */
+std::unique_ptr<Buffer> UploadQueue::createStagingBuffer(const VkDeviceSize size) {
+  auto staging = std::make_unique<Buffer>();
+  staging->allocateBuffer(
+    VK_BUFFER_USAGE_TRANSFER_SRC_BIT, 
+    VMA_MEMORY_USAGE_AUTO, 
+    VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT, 
+    size
+  );
+  return staging;
+}
+
+/**
+ * @brief recycle the command buffers and staging memory of finished batches
+ * 
+ */
+void UploadQueue::retire() {
+  while (!inFlight.empty() && timeline.isComplete(inFlight.front().timelineValue)) {
+    Batch& batch = inFlight.front();
+    vkResetCommandPool(vk::device, batch.cmd->pool, 0);
+    freeCommands.push_back(std::move(batch.cmd));
+    completedBatch = batch.id;
+    ring.reclaim(batch.timelineValue);
+    inFlight.pop_front();
+  }
+}
+
+}
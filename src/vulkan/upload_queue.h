@@ -0,0 +1,132 @@
+#pragma once
+
+#include "buffer.h"
+#include "command.h"
+#include "staging_ring.h"
+#include "timeline_semaphore.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <vulkan/vulkan_core.h>
+
+namespace mb {
+
+/**
+ * @brief identifies the batch an upload was recorded into
+ * 
+ */
+struct UploadTicket {
+  uint64_t batch = 0;
+};
+
+/**
+ * @brief batches copy requests into one submission per frame, requests
+ *        return a ticket that can be polled or waited on
+ * 
+ * Staging memory is filled after the queue is unlocked, so a slow copy or
+ * conversion only holds up the submission of its own batch.
+ * 
+ * When the upload queue belongs to a different family than the queue that
+ * consumes the resources, buffers and images written by uploadBuffer and
+ * uploadImage are released to the consumer family and the matching acquire
+ * barriers are handed out by recordAcquireBarriers. Resources written through
+ * enqueue are not transferred and should use concurrent sharing.
+ */
+class UploadQueue {
+public:
+  // fills the staging memory of an upload, called without the queue locked,
+  // must not upload through the queue itself
+  using StagingWriter = std::function<void(void* staging)>;
+
+  UploadQueue(VkQueue _queue, const uint32_t _queueFamily, TimelineSemaphore& _timeline, const uint32_t _dstQueueFamily, const VkDeviceSize stagingCapacity = 64 * 1024 * 1024);
+  ~UploadQueue();
+
+  UploadQueue (const UploadQueue&) = delete;
+  UploadQueue& operator= (const UploadQueue&) = delete;
+
+  // may be called from any thread
+  UploadTicket enqueue(std::function<void(VkCommandBuffer cmd)>&& function);
+  UploadTicket uploadBuffer(VkBuffer dst, const void* data, const VkDeviceSize size, const VkDeviceSize dstOffset = 0);
+  UploadTicket uploadBuffer(VkBuffer dst, const VkDeviceSize size, const StagingWriter& writer, const VkDeviceSize dstOffset = 0);
+  UploadTicket uploadImage(VkImage dst, const void* data, const VkDeviceSize size, const VkExtent3D extent);
+  bool isComplete(const UploadTicket ticket);
+  // the batch of the ticket must have been flushed by the owning thread
+  void wait(const UploadTicket ticket);
+
+  // submit to the queue, call from the thread that owns the queue
+  void flush();
+  void waitIdle();
+
+  // call from the thread recording the consumer queue
+  uint64_t recordAcquireBarriers(VkCommandBuffer cmd);
+  TimelineSemaphore& getTimeline() {return timeline;}
+
+private:
+  // a submitted batch and the resources it keeps alive
+  struct Batch {
+    uint64_t id;
+    uint64_t timelineValue;
+    std::unique_ptr<Command> cmd;
+    // staging buffers of requests that did not fit in the ring
+    std::vector<std::unique_ptr<Buffer>> staging;
+  };
+
+  VkQueue queue;
+  const uint32_t queueFamily;
+  TimelineSemaphore& timeline;
+  const uint32_t dstQueueFamily;
+
+  std::mutex mutex;
+  uint64_t currentBatch = 1;
+  uint64_t completedBatch = 0;
+  std::unique_ptr<Command> recordingCmd;
+  std::vector<std::unique_ptr<Buffer>> recordingStaging;
+  std::deque<Batch> inFlight;
+  std::vector<std::unique_ptr<Command>> freeCommands;
+  StagingRing ring;
+
+  // ownership transfers recorded into the current batch, and those submitted
+  // but not yet acquired by the consumer queue
+  std::vector<VkBufferMemoryBarrier> recordingBufferAcquires;
+  std::vector<VkImageMemoryBarrier> recordingImageAcquires;
+  std::vector<VkBufferMemoryBarrier> pendingBufferAcquires;
+  std::vector<VkImageMemoryBarrier> pendingImageAcquires;
+  uint64_t pendingAcquireValue = 0;
+
+  // staging memory reserved for a request, filled once the queue is unlocked
+  struct StagingReservation {
+    StagingAllocation allocation;
+    // buffer of the request when the ring was full, null otherwise
+    Buffer* dedicated;
+  };
+
+  // requests recorded into the current batch whose staging memory is still
+  // being filled, the batch is not submitted before they finish, new
+  // requests wait while a flush drains them so it cannot be starved
+  uint32_t pendingWrites = 0;
+  bool flushing = false;
+  // signalled when a write finishes, a flush stops draining or a batch is
+  // submitted
+  std::condition_variable queueChanged;
+  // the thread that constructed the queue and submits its batches
+  const std::thread::id owner = std::this_thread::get_id();
+
+  bool transfersOwnership() const {return queueFamily != dstQueueFamily;}
+
+  VkCommandBuffer beginBatch();
+  std::unique_lock<std::mutex> lockForRequest();
+  StagingReservation reserve(std::unique_lock<std::mutex>& lock, const VkDeviceSize size);
+  void submit(std::unique_lock<std::mutex>& lock);
+  void write(const StagingReservation& staging, const VkDeviceSize size, const StagingWriter& writer);
+  std::unique_ptr<Buffer> createStagingBuffer(const VkDeviceSize size);
+  void retire();
+};
+
+}
@@ -1,9 +1,11 @@
 #include "vk.h"
+#include "image_buffer.h"
 
 #define VMA_IMPLEMENTATION
 #include "../util/vk_mem_alloc.h"
 
 #include <cstdint>
+#include <cstring>
 #include <memory>
 #include <stdexcept>
 #include <set>
@@ -23,20 +25,37 @@ namespace mb {
    * 
    * @param width : the width of the window
    * @param height : the height of the window
+   * @param framesInFlight : number of offscreen images to render into when headless
+   * @param _headless : render into offscreen images without a window, surface or present queue
+   * @param allowDynamicRendering : use dynamic rendering when the device supports it
+   * @param allowExtendedDynamicState : set the state of RenderState while recording when the device supports it
    */
-  void vk::init(uint32_t width, uint32_t height, const unsigned int FRAME_COUNT) {
+  void vk::init(uint32_t width, uint32_t height, uint32_t framesInFlight, bool _headless, 
+      bool allowDynamicRendering, bool allowExtendedDynamicState) {
+    headless = _headless;
+    dynamicRendering = allowDynamicRendering;
+    extendedDynamicState.state1 = allowExtendedDynamicState;
+
     // initalize window
     VkExtent2D extent{width, height};
-    window = std::make_unique<Window>();
-    window->init(extent);
+    if (!headless) {
+      window = std::make_unique<Window>();
+      window->init(extent);
+    }
 
     // initalize vulkan handlers
     createInstance();
     if (enableValidationLayers) setupDebugMessenger();
-    createSurface();
+    if (!headless) createSurface();
     createDevice();
     createAllocator();
-    swapchain = std::make_unique<Swapchain>(instance,device,physicalDevice,queueIndices,surface,window->instance);
+    // render passes and framebuffers are only needed without dynamic rendering
+    if (headless) {
+      offscreen = std::make_unique<OffscreenTarget>(extent, framesInFlight, VK_FORMAT_R8G8B8A8_UNORM, !dynamicRendering);
+    }
+    else {
+      swapchain = std::make_unique<Swapchain>(instance,device,physicalDevice,queueIndices,surface,window->instance,!dynamicRendering);
+    }
 
     initialized = true;
   }
@@ -52,13 +71,81 @@ namespace mb {
 
     // destroy vulkan handlers in the correct order
     swapchain.reset();
+    offscreen.reset();
     vmaDestroyAllocator(allocator);
     vkDestroyDevice(device, nullptr);
-    vkDestroySurfaceKHR(instance, surface, nullptr);
+    if (!headless) vkDestroySurfaceKHR(instance, surface, nullptr);
     vkDestroyInstance(instance, nullptr);
     window.reset();
   }
 
+  /**
+   * @brief retrieve the render pass of the active render target
+   * 
+   * @return VkRenderPass 
+   */
+  VkRenderPass vk::getRenderPass() {
+    return headless ? offscreen->renderPass : swapchain->renderPass;
+  }
+
+  /**
+   * @brief retrieve the framebuffer of the active render target
+   * 
+   * @param imageIndex : index of the swapchain or offscreen image
+   * @return VkFramebuffer 
+   */
+  VkFramebuffer vk::getFramebuffer(const uint32_t imageIndex) {
+    return headless ? offscreen->framebuffers[imageIndex] : swapchain->framebuffers[imageIndex];
+  }
+
+  /**
+   * @brief retrieve the dimensions of the active render target
+   * 
+   * @return VkExtent2D 
+   */
+  VkExtent2D vk::getRenderExtent() {
+    return headless ? offscreen->extent : swapchain->swapchainExtent;
+  }
+
+  /**
+   * @brief retrieve the color format of the active render target
+   * 
+   * @return VkFormat 
+   */
+  VkFormat vk::getRenderFormat() {
+    return headless ? offscreen->format : swapchain->swapchainFormat.format;
+  }
+
+  /**
+   * @brief retrieve an image of the active render target
+   * 
+   * @param imageIndex : index of the swapchain or offscreen image
+   * @return VkImage 
+   */
+  VkImage vk::getRenderImage(const uint32_t imageIndex) {
+    return headless ? offscreen->images[imageIndex]->get() : swapchain->images[imageIndex];
+  }
+
+  /**
+   * @brief retrieve an image view of the active render target
+   * 
+   * @param imageIndex : index of the swapchain or offscreen image
+   * @return VkImageView 
+   */
+  VkImageView vk::getRenderImageView(const uint32_t imageIndex) {
+    return headless ? offscreen->imageViews[imageIndex] : swapchain->imageViews[imageIndex];
+  }
+
+  /**
+   * @brief retrieve the layout the active render target is left in after
+   *        rendering, ready to present or read back
+   * 
+   * @return VkImageLayout 
+   */
+  VkImageLayout vk::getRenderFinalLayout() {
+    return headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+  }
+
   /**
    * @brief creates a new Vulkan API instance
    * 
@@ -71,7 +158,8 @@ namespace mb {
     appInfo.applicationVersion = VK_MAKE_API_VERSION(1, 0, 0, 0);
     appInfo.pEngineName = "No Engine"; // app is custom engine
     appInfo.engineVersion = VK_MAKE_API_VERSION(1, 0, 0, 0);
-    appInfo.apiVersion = VK_API_VERSION_1_0;
+    // 1.2 is required, 1.3 is used for dynamic rendering when the device has it
+    appInfo.apiVersion = VK_API_VERSION_1_3;
 
     VkInstanceCreateInfo instanceInfo{};
     instanceInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -105,12 +193,16 @@ namespace mb {
    * @return std::vector<const char*> the extensions that the application uses
    */
   std::vector<const char*> vk::getRequiredExtensions() {
-    uint32_t sdlExtensionCount = 0;
-    SDL_Vulkan_GetInstanceExtensions(window->instance,&sdlExtensionCount,NULL);
-    std::vector<const char*> sdlExtensions(sdlExtensionCount); 
-    SDL_Vulkan_GetInstanceExtensions(window->instance,&sdlExtensionCount,sdlExtensions.data());
-
-    std::vector<const char*> extensions(sdlExtensions);
+    std::vector<const char*> extensions;
+
+    // surface extensions are only needed when presenting to a window
+    if (!headless) {
+      uint32_t sdlExtensionCount = 0;
+      SDL_Vulkan_GetInstanceExtensions(window->instance,&sdlExtensionCount,NULL);
+      std::vector<const char*> sdlExtensions(sdlExtensionCount); 
+      SDL_Vulkan_GetInstanceExtensions(window->instance,&sdlExtensionCount,sdlExtensions.data());
+      extensions = sdlExtensions;
+    }
 
     if (enableValidationLayers) {
       extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -162,6 +254,7 @@ namespace mb {
     allocatorCreateInfo.pHeapSizeLimit = nullptr;
     allocatorCreateInfo.pVulkanFunctions = nullptr;
     allocatorCreateInfo.instance = instance;
+    allocatorCreateInfo.vulkanApiVersion = VK_API_VERSION_1_2;
     
     if (vmaCreateAllocator(&allocatorCreateInfo, &allocator) != VK_SUCCESS) {
       throw std::runtime_error("[ERROR]: failed to create vma allocator");
@@ -181,8 +274,13 @@ namespace mb {
   void vk::createDevice() {
     pickPhysicalDevice();
     getQueueFamilies();
+    dynamicRendering = dynamicRendering && checkDynamicRenderingSupport();
+    if (extendedDynamicState.state1) {
+      extendedDynamicState = checkExtendedDynamicStateSupport();
+    }
     createLogicalDevice();
     getQueues();
+    loadDeviceFunctions();
   }
 
   /**
@@ -220,7 +318,115 @@ namespace mb {
   * @return false : if device does not meet requirements
   */
   bool vk::isDeviceSuitable(VkPhysicalDevice device) {
-    return true;
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(device, &properties);
+    if (properties.apiVersion < VK_API_VERSION_1_2) {
+      return false;
+    }
+
+    // frame pacing and upload tracking are built on timeline semaphores
+    VkPhysicalDeviceVulkan12Features features12 {};
+    features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    VkPhysicalDeviceFeatures2 features {};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &features12;
+    vkGetPhysicalDeviceFeatures2(device, &features);
+
+    return features12.timelineSemaphore == VK_TRUE;
+  }
+
+  /**
+  * @brief checks if the selected GPU supports dynamic rendering, either in
+  *        core 1.3 or through VK_KHR_dynamic_rendering
+  * 
+  * @return true if dynamic rendering can be enabled
+  */
+  bool vk::checkDynamicRenderingSupport() {
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+    VkPhysicalDeviceDynamicRenderingFeatures dynamicRenderingFeatures {};
+    dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES;
+    VkPhysicalDeviceFeatures2 features {};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &dynamicRenderingFeatures;
+
+    dynamicRenderingCore = properties.apiVersion >= VK_API_VERSION_1_3;
+    if (!dynamicRenderingCore && !checkDeviceExtensionSupport(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME)) {
+      return false;
+    }
+
+    vkGetPhysicalDeviceFeatures2(physicalDevice, &features);
+    return dynamicRenderingFeatures.dynamicRendering == VK_TRUE;
+  }
+
+  /**
+  * @brief checks which groups of extended dynamic state the selected GPU
+  *        supports, 1 and 2 are core in 1.3 while blend state needs
+  *        VK_EXT_extended_dynamic_state3
+  * 
+  * @return ExtendedDynamicState : the supported groups, each builds on the previous
+  */
+  ExtendedDynamicState vk::checkExtendedDynamicStateSupport() {
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    extendedDynamicStateCore = properties.apiVersion >= VK_API_VERSION_1_3;
+
+    // feature structs may only be chained for extensions the device exposes
+    const bool state1Extension = !extendedDynamicStateCore && checkDeviceExtensionSupport(VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME);
+    const bool state2Extension = !extendedDynamicStateCore && checkDeviceExtensionSupport(VK_EXT_EXTENDED_DYNAMIC_STATE_2_EXTENSION_NAME);
+    const bool state3Extension = checkDeviceExtensionSupport(VK_EXT_EXTENDED_DYNAMIC_STATE_3_EXTENSION_NAME);
+
+    VkPhysicalDeviceExtendedDynamicStateFeaturesEXT state1Features {};
+    state1Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_FEATURES_EXT;
+    VkPhysicalDeviceExtendedDynamicState2FeaturesEXT state2Features {};
+    state2Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_2_FEATURES_EXT;
+    VkPhysicalDeviceExtendedDynamicState3FeaturesEXT state3Features {};
+    state3Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_3_FEATURES_EXT;
+    VkPhysicalDeviceFeatures2 features {};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+
+    void** next = &features.pNext;
+    if (state1Extension) {
+      *next = &state1Features;
+      next = &state1Features.pNext;
+    }
+    if (state2Extension) {
+      *next = &state2Features;
+      next = &state2Features.pNext;
+    }
+    if (state3Extension) {
+      *next = &state3Features;
+      next = &state3Features.pNext;
+    }
+    vkGetPhysicalDeviceFeatures2(physicalDevice, &features);
+
+    ExtendedDynamicState support {};
+    support.state1 = extendedDynamicStateCore || (state1Extension && state1Features.extendedDynamicState == VK_TRUE);
+    support.state2 = support.state1 && (extendedDynamicStateCore || (state2Extension && state2Features.extendedDynamicState2 == VK_TRUE));
+    support.blend = support.state2 && state3Extension
+      && state3Features.extendedDynamicState3ColorBlendEnable == VK_TRUE
+      && state3Features.extendedDynamicState3ColorBlendEquation == VK_TRUE
+      && state3Features.extendedDynamicState3ColorWriteMask == VK_TRUE;
+    return support;
+  }
+
+  /**
+  * @brief checks if the selected GPU exposes a device extension
+  * 
+  */
+  bool vk::checkDeviceExtensionSupport(const char* extension) {
+    uint32_t extensionCount = 0;
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+    std::vector<VkExtensionProperties> extensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, extensions.data());
+
+    for (const auto& properties : extensions) {
+      if (strcmp(properties.extensionName, extension) == 0) {
+        return true;
+      }
+    }
+    return false;
   }
 
   /**
@@ -243,19 +449,44 @@ namespace mb {
         indices.graphicsFamily = i;
       }
       // check for present support
-      VkBool32 presentSupport = false;
-      vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, i, surface, &presentSupport);
-      if (presentSupport) {
-        indices.presentFamily = i;
+      if (!headless) {
+        VkBool32 presentSupport = false;
+        vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, i, surface, &presentSupport);
+        if (presentSupport) {
+          indices.presentFamily = i;
+        }
       }
       // check if all queue families have been filled
-      if (indices.isComplete()) {
+      if (indices.isComplete() || (headless && indices.graphicsFamily.has_value())) {
         break;
       }
 
       i++;
     }
 
+    // prefer a transfer only (DMA) family, then any non graphics family that
+    // can transfer, so uploads can overlap rendering
+    for (uint32_t family = 0; family < queueFamilyCount; family++) {
+      const VkQueueFlags flags = queueFamilies[family].queueFlags;
+      if ((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))) {
+        indices.transferFamily = family;
+        break;
+      }
+    }
+    if (!indices.transferFamily.has_value()) {
+      for (uint32_t family = 0; family < queueFamilyCount; family++) {
+        const VkQueueFlags flags = queueFamilies[family].queueFlags;
+        if ((flags & (VK_QUEUE_TRANSFER_BIT | VK_QUEUE_COMPUTE_BIT)) && !(flags & VK_QUEUE_GRAPHICS_BIT)) {
+          indices.transferFamily = family;
+          break;
+        }
+      }
+    }
+    // fall back to the graphics queue
+    if (!indices.transferFamily.has_value()) {
+      indices.transferFamily = indices.graphicsFamily;
+    }
+
     queueIndices = indices;
   }
 
@@ -267,9 +498,12 @@ namespace mb {
     // info for queues
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
     std::set<uint32_t> uniqueQueueFamilies = {
-      queueIndices.graphicsFamily.value(), 
-      queueIndices.presentFamily.value()
+      queueIndices.graphicsFamily.value(),
+      queueIndices.transferFamily.value()
     };
+    if (queueIndices.presentFamily.has_value()) {
+      uniqueQueueFamilies.insert(queueIndices.presentFamily.value());
+    }
 
     float queuePriority = 1.0f;
     for (uint32_t queueFamily : uniqueQueueFamilies) {
@@ -283,6 +517,45 @@ namespace mb {
 
     // set device features
     VkPhysicalDeviceFeatures deviceFeatures{};
+    VkPhysicalDeviceVulkan12Features features12 {};
+    features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    features12.timelineSemaphore = VK_TRUE;
+
+    // the feature struct is shared by core 1.3 and the extension
+    VkPhysicalDeviceDynamicRenderingFeatures dynamicRenderingFeatures {};
+    dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES;
+    dynamicRenderingFeatures.dynamicRendering = VK_TRUE;
+    // extended dynamic state 1 and 2 need no features when they are core
+    VkPhysicalDeviceExtendedDynamicStateFeaturesEXT state1Features {};
+    state1Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_FEATURES_EXT;
+    state1Features.extendedDynamicState = VK_TRUE;
+    VkPhysicalDeviceExtendedDynamicState2FeaturesEXT state2Features {};
+    state2Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_2_FEATURES_EXT;
+    state2Features.extendedDynamicState2 = VK_TRUE;
+    VkPhysicalDeviceExtendedDynamicState3FeaturesEXT state3Features {};
+    state3Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_3_FEATURES_EXT;
+    state3Features.extendedDynamicState3ColorBlendEnable = VK_TRUE;
+    state3Features.extendedDynamicState3ColorBlendEquation = VK_TRUE;
+    state3Features.extendedDynamicState3ColorWriteMask = VK_TRUE;
+
+    // chain the optional features behind the 1.2 features
+    void** next = &features12.pNext;
+    if (dynamicRendering) {
+      *next = &dynamicRenderingFeatures;
+      next = &dynamicRenderingFeatures.pNext;
+    }
+    if (extendedDynamicState.state1 && !extendedDynamicStateCore) {
+      *next = &state1Features;
+      next = &state1Features.pNext;
+    }
+    if (extendedDynamicState.state2 && !extendedDynamicStateCore) {
+      *next = &state2Features;
+      next = &state2Features.pNext;
+    }
+    if (extendedDynamicState.blend) {
+      *next = &state3Features;
+      next = &state3Features.pNext;
+    }
 
     // get device extensions
     auto extensions = getRequiredDeviceExtensions();
@@ -290,6 +563,7 @@ namespace mb {
     // device info
     VkDeviceCreateInfo deviceInfo{};
     deviceInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    deviceInfo.pNext = &features12;
     deviceInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
     deviceInfo.pQueueCreateInfos = queueCreateInfos.data();
     deviceInfo.pEnabledFeatures = &deviceFeatures;
@@ -307,7 +581,25 @@ namespace mb {
   * @return std::vector<const char*> 
   */
   std::vector<const char*> vk::getRequiredDeviceExtensions() {
-    std::vector<const char*> extensions(deviceExtensions);
+    std::vector<const char*> extensions;
+
+    // headless rendering never presents, so the swapchain extension is not needed
+    if (!headless) {
+      extensions = deviceExtensions;
+    }
+    if (dynamicRendering && !dynamicRenderingCore) {
+      extensions.push_back(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+    }
+    if (extendedDynamicState.state1 && !extendedDynamicStateCore) {
+      extensions.push_back(VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME);
+    }
+    if (extendedDynamicState.state2 && !extendedDynamicStateCore) {
+      extensions.push_back(VK_EXT_EXTENDED_DYNAMIC_STATE_2_EXTENSION_NAME);
+    }
+    if (extendedDynamicState.blend) {
+      extensions.push_back(VK_EXT_EXTENDED_DYNAMIC_STATE_3_EXTENSION_NAME);
+    }
+
     return extensions;
   }
 
@@ -317,7 +609,41 @@ namespace mb {
   */
   void vk::getQueues() {
     vkGetDeviceQueue(device, queueIndices.graphicsFamily.value(), 0, &graphicsQueue);
-    vkGetDeviceQueue(device, queueIndices.presentFamily.value(), 0, &presentQueue);
+    vkGetDeviceQueue(device, queueIndices.transferFamily.value(), 0, &transferQueue);
+    if (queueIndices.presentFamily.has_value()) {
+      vkGetDeviceQueue(device, queueIndices.presentFamily.value(), 0, &presentQueue);
+    }
+  }
+
+  /**
+  * @brief load device entry points that are not exported by the loader
+  * 
+  */
+  void vk::loadDeviceFunctions() {
+    if (dynamicRendering) {
+      const char* suffix = dynamicRenderingCore ? "" : "KHR";
+      loadDeviceFunction(cmdBeginRendering, "vkCmdBeginRendering", suffix);
+      loadDeviceFunction(cmdEndRendering, "vkCmdEndRendering", suffix);
+    }
+
+    const char* suffix = extendedDynamicStateCore ? "" : "EXT";
+    if (extendedDynamicState.state1) {
+      loadDeviceFunction(cmdSetCullMode, "vkCmdSetCullMode", suffix);
+      loadDeviceFunction(cmdSetFrontFace, "vkCmdSetFrontFace", suffix);
+      loadDeviceFunction(cmdSetPrimitiveTopology, "vkCmdSetPrimitiveTopology", suffix);
+      loadDeviceFunction(cmdSetDepthTestEnable, "vkCmdSetDepthTestEnable", suffix);
+      loadDeviceFunction(cmdSetDepthWriteEnable, "vkCmdSetDepthWriteEnable", suffix);
+      loadDeviceFunction(cmdSetDepthCompareOp, "vkCmdSetDepthCompareOp", suffix);
+    }
+    if (extendedDynamicState.state2) {
+      loadDeviceFunction(cmdSetPrimitiveRestartEnable, "vkCmdSetPrimitiveRestartEnable", suffix);
+      loadDeviceFunction(cmdSetDepthBiasEnable, "vkCmdSetDepthBiasEnable", suffix);
+    }
+    if (extendedDynamicState.blend) {
+      loadDeviceFunction(cmdSetColorBlendEnable, "vkCmdSetColorBlendEnable", "EXT");
+      loadDeviceFunction(cmdSetColorBlendEquation, "vkCmdSetColorBlendEquation", "EXT");
+      loadDeviceFunction(cmdSetColorWriteMask, "vkCmdSetColorWriteMask", "EXT");
+    }
   }
 
   /**
@@ -2,11 +2,14 @@
 
 #include "window.h"
 #include "swapchain.h"
+#include "offscreen_target.h"
 
 #include "../util/vk_mem_alloc.h"
 #include "../util/types.h"
 
 #include <memory>
+#include <stdexcept>
+#include <string>
 #include <vector>
 #include <iostream>
 
@@ -44,6 +47,10 @@ public:
   inline static VmaAllocator allocator;
   inline static VkSurfaceKHR surface;
   inline static std::unique_ptr<Swapchain> swapchain;
+  inline static std::unique_ptr<OffscreenTarget> offscreen;
+  inline static bool headless = false;
+  // render with vkCmdBeginRendering instead of render passes and framebuffers
+  inline static bool dynamicRendering = false;
 
   // vulkan device handlers
   inline static VkPhysicalDevice physicalDevice;
@@ -51,14 +58,49 @@ public:
   inline static QueueFamilyIndices queueIndices;
   inline static VkQueue graphicsQueue;
   inline static VkQueue presentQueue;
+  inline static VkQueue transferQueue;
+
+  // VK_KHR_dynamic_rendering or core 1.3 entry points, set when dynamicRendering is
+  inline static PFN_vkCmdBeginRenderingKHR cmdBeginRendering = nullptr;
+  inline static PFN_vkCmdEndRenderingKHR cmdEndRendering = nullptr;
+
+  // state left out of pipelines and set while recording, see RenderState
+  inline static ExtendedDynamicState extendedDynamicState;
+  inline static PFN_vkCmdSetCullModeEXT cmdSetCullMode = nullptr;
+  inline static PFN_vkCmdSetFrontFaceEXT cmdSetFrontFace = nullptr;
+  inline static PFN_vkCmdSetPrimitiveTopologyEXT cmdSetPrimitiveTopology = nullptr;
+  inline static PFN_vkCmdSetDepthTestEnableEXT cmdSetDepthTestEnable = nullptr;
+  inline static PFN_vkCmdSetDepthWriteEnableEXT cmdSetDepthWriteEnable = nullptr;
+  inline static PFN_vkCmdSetDepthCompareOpEXT cmdSetDepthCompareOp = nullptr;
+  inline static PFN_vkCmdSetPrimitiveRestartEnableEXT cmdSetPrimitiveRestartEnable = nullptr;
+  inline static PFN_vkCmdSetDepthBiasEnableEXT cmdSetDepthBiasEnable = nullptr;
+  inline static PFN_vkCmdSetColorBlendEnableEXT cmdSetColorBlendEnable = nullptr;
+  inline static PFN_vkCmdSetColorBlendEquationEXT cmdSetColorBlendEquation = nullptr;
+  inline static PFN_vkCmdSetColorWriteMaskEXT cmdSetColorWriteMask = nullptr;
 
   vk(){initialized = false;}
   ~vk();
 
-  static void init(uint32_t width = 900, uint32_t height = 600, const unsigned int FRAME_COUNT = 2);
+  static void init(uint32_t width = 900, uint32_t height = 600, uint32_t framesInFlight = 2, bool _headless = false, 
+    bool allowDynamicRendering = true, bool allowExtendedDynamicState = true);
+
+  static bool hasDedicatedTransfer() {return queueIndices.transferFamily != queueIndices.graphicsFamily;}
+
+  // active render target, either the swapchain or the offscreen images
+  static VkRenderPass getRenderPass();
+  static VkFramebuffer getFramebuffer(const uint32_t imageIndex);
+  static VkExtent2D getRenderExtent();
+  static VkFormat getRenderFormat();
+  static VkImage getRenderImage(const uint32_t imageIndex);
+  static VkImageView getRenderImageView(const uint32_t imageIndex);
+  static VkImageLayout getRenderFinalLayout();
 private:
   // interface states
   inline static bool initialized;
+  // dynamic rendering is available as core 1.3 rather than the extension
+  inline static bool dynamicRenderingCore = false;
+  // extended dynamic state 1 and 2 are available as core 1.3 rather than the extensions
+  inline static bool extendedDynamicStateCore = false;
   static void terminate();
 
   // VK instance related functions
@@ -74,10 +116,26 @@ private:
   static void createDevice();
   static void pickPhysicalDevice();
   static bool isDeviceSuitable(VkPhysicalDevice device);
+  static bool checkDynamicRenderingSupport();
+  static ExtendedDynamicState checkExtendedDynamicStateSupport();
+  static bool checkDeviceExtensionSupport(const char* extension);
   static void getQueueFamilies();
   static void createLogicalDevice();
   static std::vector<const char*> getRequiredDeviceExtensions();
   static void getQueues();
+  static void loadDeviceFunctions();
+
+  /**
+   * @brief load a device entry point, by its core name or with an extension suffix
+   * 
+   */
+  template<typename T>
+  static void loadDeviceFunction(T& function, const std::string& name, const char* suffix) {
+    function = reinterpret_cast<T>(vkGetDeviceProcAddr(device, (name + suffix).c_str()));
+    if (function == nullptr) {
+      throw std::runtime_error("[ERROR]: failed to load " + name + suffix);
+    }
+  }
 
   // debug related functions
   inline static VkDebugUtilsMessengerEXT debugMessenger;